@@ -0,0 +1,32 @@
+#ifndef BCC_BENCH
+#define BCC_BENCH
+
+#include "util.h"
+#include <chrono>
+#include <cstdint>
+
+namespace Bench
+{
+
+// Best wall-clock time over a few runs, in seconds
+template <typename F> double best_of(int runs, F&& f)
+{
+    double best = 1e100;
+    for (int i = 0; i < runs; i++) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        std::chrono::duration<double> took =
+            std::chrono::steady_clock::now() - start;
+        if (took.count() < best) best = took.count();
+    }
+    return best;
+}
+
+// Keeps the optimizer from throwing a result away
+template <typename T> void keep(T const& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+} // namespace Bench
+#endif
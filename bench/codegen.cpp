@@ -0,0 +1,90 @@
+#include "IR.h"
+#include "bench.h"
+#include "codegen.h"
+#include "generate.h"
+#include "parser.h"
+#include "translate.h"
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Tree::spill and codegen::__flat_rec read a few fields of every
+// node, so they mostly measure the IR accessors; emission measures
+// how the assembly text scales with the program. Each run gets a
+// fresh copy of the tree, made before the clock starts.
+int main()
+{
+    std::string const program = Bench::generate(100, 10);
+    Parser            parser("bench", std::string_view(program));
+    auto const        ast = parser.Program();
+
+    IR::Tree tree;
+    IR::translate(tree, ast);
+
+    // The tags, the inline fields and the out-of-line payloads
+    Util::write(std::cout, "node storage",
+                double(tree.bytes()) / tree.size(), "bytes per node");
+
+    int const             runs = 5;
+    std::vector<IR::Tree> copies(runs, tree);
+    size_t                next = 0;
+    double spill = Bench::best_of(runs, [&] {
+        copies[next++].simplify();
+        Bench::keep(copies[next - 1]);
+    });
+    Util::write(std::cout, "spilling", spill * 1e3, "ms");
+
+    copies.assign(runs, tree);
+    next = 0;
+    double flatten = Bench::best_of(runs, [&] {
+        std::stringstream out;
+        GEN::codegen      code(&out, copies[next++]);
+        Bench::keep(code);
+    });
+    Util::write(std::cout, "spilling and flattening", flatten * 1e3,
+                "ms");
+
+    // Writing the assembly out, once the tree is ready
+    copies.assign(runs, tree);
+    std::vector<std::stringstream>             sinks(runs);
+    std::vector<std::unique_ptr<GEN::codegen>> code;
+    for (int i = 0; i < runs; i++)
+        code.emplace_back(new GEN::codegen(&sinks[i], copies[i]));
+    next = 0;
+    double write =
+        Bench::best_of(runs, [&] { code[next++]->output(); });
+    Util::write(std::cout, "emission", write * 1e3, "ms");
+
+    // An analysis of the lowered tree, built again from scratch or
+    // brought up to date after a hundred nodes changed
+    IR::Tree const& lowered = copies[0];
+    double          rebuild = Bench::best_of(runs, [&] {
+        IR::Catamorphism<GEN::SethiUllman, int> need(lowered);
+        Bench::keep(need.x);
+    });
+    Util::write(std::cout, "register need, from scratch",
+                rebuild * 1e3, "ms");
+
+    IR::Catamorphism<GEN::SethiUllman, int> need(IR::incremental{},
+                                                 lowered);
+    size_t const step    = lowered.size() / 100;
+    double       refresh = Bench::best_of(runs, [&] {
+        for (size_t i = 0; i < lowered.size(); i += step)
+            need.invalidate(i);
+        need.update();
+    });
+    Util::write(std::cout, "register need, updated", refresh * 1e3,
+                "ms");
+
+    for (unsigned threads : {1u, 0u}) {
+        char const* mode = threads == 1 ? "(serial)" : "(parallel)";
+        double      text = Bench::best_of(runs, [&] {
+            IR::Catamorphism<IR::DeepFormat, std::string> F(
+                IR::in_parallel{threads}, lowered);
+            Bench::keep(F.x);
+        });
+        Util::write(std::cout, "node text for a dump", mode,
+                    text * 1e3, "ms");
+    }
+}
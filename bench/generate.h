@@ -0,0 +1,56 @@
+#ifndef BCC_BENCH_GENERATE
+#define BCC_BENCH_GENERATE
+
+#include <string>
+
+namespace Bench
+{
+
+// A valid miniJava program with the given number of classes, each
+// with `methods` methods. Every third class extends the one before
+// it, and methods call the ones declared before them, so the output
+// exercises the whole pipeline and not only the lexer.
+inline std::string generate(int classes, int methods)
+{
+    std::string out = "class Main {\n"
+                      "    public static void main(String[] a) {\n"
+                      "        System.out.println(new C0().m0_0(1, 2));\n"
+                      "    }\n"
+                      "}\n";
+    for (int c = 0; c < classes; c++) {
+        std::string const C = std::to_string(c);
+        out += "class C" + C;
+        if (c % 3 == 2) out += " extends C" + std::to_string(c - 1);
+        out += " {\n";
+        for (int k = 0; k < 4; k++)
+            out += "    int f" + C + "_" + std::to_string(k) + ";\n";
+        for (int m = 0; m < methods; m++) {
+            std::string const M = C + "_" + std::to_string(m);
+            out += "    // method " + M + "\n"
+                   "    public int m" + M + "(int x, int y) {\n"
+                   "        int sum;\n"
+                   "        int i;\n"
+                   "        sum = 0;\n"
+                   "        i = x;\n"
+                   "        while (i < y) {\n"
+                   "            if (i < 10 && 0 < i)\n"
+                   "                sum = sum + i * 2;\n"
+                   "            else\n"
+                   "                sum = sum - 1;\n"
+                   "            i = i + 1;\n"
+                   "        }\n";
+            if (c % 3 != 2) out += "        f" + C + "_0 = sum;\n";
+            if (m > 0)
+                out += "        sum = sum + this.m" + C + "_" +
+                       std::to_string(m - 1) + "(sum, 12345);\n";
+            out += "        System.out.println(sum);\n"
+                   "        return sum;\n"
+                   "    }\n";
+        }
+        out += "}\n";
+    }
+    return out;
+}
+
+} // namespace Bench
+#endif
@@ -0,0 +1,110 @@
+#include "bench.h"
+#include "lexer.h"
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+
+// The Trie the lexer used before Keywords::classify, kept here as the
+// baseline for comparison.
+class Trie
+{
+    template <typename T> using ptr = std::unique_ptr<T>;
+    struct Node {
+        Lexeme    label = Lexeme::identifier;
+        ptr<Node> child[1 + std::numeric_limits<char>::max()];
+    };
+    ptr<Node> root;
+
+  public:
+    Trie()
+    {
+        root = std::make_unique<Node>();
+        for (size_t i = 0; i < reserved_words.size(); i++) {
+            Node* node = root.get();
+            for (char c : reserved_words[i]) {
+                int j = static_cast<int>(c);
+                if (!node->child[j])
+                    node->child[j] = std::make_unique<Node>();
+                node = node->child[j].get();
+            }
+            node->child[0]        = std::make_unique<Node>();
+            node->child[0]->label = static_cast<Lexeme>(
+                static_cast<int>(Lexeme::boolean_keyword) + i);
+        }
+    }
+
+    Lexeme search(std::string_view q) const
+    {
+        Node* node = root.get();
+        for (char c : q) {
+            if (node->child[static_cast<int>(c)])
+                node = node->child[static_cast<int>(c)].get();
+            else
+                return Lexeme::identifier;
+        }
+        if (!node->child[0]) return Lexeme::identifier;
+        return node->child[0]->label;
+    }
+};
+
+static std::vector<std::string> identifiers(size_t n)
+{
+    static const std::string alphabet =
+        "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_0123456789";
+    std::mt19937                    gen(42);
+    std::uniform_int_distribution<> len(1, 12), chr(0, 51);
+    std::vector<std::string>        ans;
+    while (ans.size() < n) {
+        std::string word;
+        int         l = len(gen);
+        for (int i = 0; i < l; i++) word += alphabet[chr(gen)];
+        // Near misses, like "whilst" and "in", are the hard cases
+        if (ans.size() % 4 == 0) {
+            auto const& kw = reserved_words[ans.size() % 18];
+            word           = std::string(kw.substr(0, kw.size() - 1));
+        }
+        if (Keywords::classify(word) == Lexeme::identifier)
+            ans.push_back(word);
+    }
+    return ans;
+}
+
+static std::vector<std::string> keywords(size_t n)
+{
+    std::vector<std::string> ans;
+    for (size_t i = 0; i < n; i++)
+        ans.emplace_back(reserved_words[i % reserved_words.size()]);
+    return ans;
+}
+
+template <typename F>
+static void measure(char const* what, std::vector<std::string> const& words,
+                    F&& classify)
+{
+    int const rounds = 200;
+    double    secs   = Bench::best_of(5, [&] {
+        int sum = 0;
+        for (int r = 0; r < rounds; r++)
+            for (auto const& w : words) sum += int(classify(w));
+        Bench::keep(sum);
+    });
+    Util::write(std::cout, what,
+                (rounds * words.size()) / secs / 1e6, "M lookups/s");
+}
+
+int main()
+{
+    Trie const trie;
+    auto const ids = identifiers(1 << 14);
+    auto const kws = keywords(1 << 14);
+
+    measure("Trie::search       identifiers", ids,
+            [&](std::string const& w) { return trie.search(w); });
+    measure("Keywords::classify identifiers", ids,
+            [](std::string const& w) { return Keywords::classify(w); });
+    measure("Trie::search       keywords   ", kws,
+            [&](std::string const& w) { return trie.search(w); });
+    measure("Keywords::classify keywords   ", kws,
+            [](std::string const& w) { return Keywords::classify(w); });
+}
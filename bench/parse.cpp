@@ -0,0 +1,52 @@
+#include "bench.h"
+#include "generate.h"
+#include "parser.h"
+#include <atomic>
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+#include <string>
+
+// Every heap allocation in the process goes through here
+static std::atomic<size_t> allocations{0};
+
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+int main()
+{
+    std::string const program = Bench::generate(200, 20);
+    double const      mb      = program.size() / 1e6;
+
+    size_t const before = allocations;
+    size_t const heap   = mallinfo2().uordblks;
+    {
+        Parser       parser("bench", std::string_view(program));
+        size_t const lexed = mallinfo2().uordblks;
+        auto         ast   = parser.Program();
+        Bench::keep(ast);
+        // What parsing adds once the tokens are there
+        size_t const bytes = mallinfo2().uordblks - lexed;
+        Util::write(std::cout, "syntax tree", bytes, "bytes, per KB",
+                    bytes / (program.size() / 1e3));
+    }
+    size_t const used = allocations - before;
+    Util::write(std::cout, "allocations", used, "per KB",
+                used / (program.size() / 1e3));
+    Util::write(std::cout, "left after the parser",
+                mallinfo2().uordblks - heap, "bytes");
+
+    double parse = Bench::best_of(5, [&] {
+        Parser parser("bench", std::string_view(program));
+        auto   ast = parser.Program();
+        Bench::keep(ast);
+    });
+    Util::write(std::cout, "lex and parse", mb / parse, "MB/s");
+}
@@ -0,0 +1,60 @@
+#include "bench.h"
+#include "generate.h"
+#include "lexer.h"
+#include "scan.h"
+#include <string>
+
+static char const* name(Scan::Isa isa)
+{
+    switch (isa) {
+    case Scan::Isa::avx2:
+        return "avx2  ";
+    case Scan::Isa::sse2:
+        return "sse2  ";
+    default:
+        return "scalar";
+    }
+}
+
+// Skips every run of cls in text, stepping over the gaps in between
+static void runs(Scan::Isa isa, Scan::CharClass cls,
+                 char const* what, std::string const& text)
+{
+    double secs = Bench::best_of(5, [&] {
+        size_t lo = 0, n = 0;
+        while (lo < text.size()) {
+            lo = Scan::span(isa, cls, text, lo);
+            while (lo < text.size() && !Scan::is(cls, text[lo])) lo++;
+            n++;
+        }
+        Bench::keep(n);
+    });
+    Util::write(std::cout, name(isa), what, text.size() / secs / 1e6,
+                "MB/s");
+}
+
+int main()
+{
+    std::string const program = Bench::generate(200, 20);
+
+    // Indentation is the long whitespace run in real code
+    std::string indented;
+    for (int i = 0; i < 1 << 16; i++)
+        indented += std::string(4 * (1 + i % 4), ' ') + "x = y;\n";
+
+    using Scan::Isa;
+    for (auto isa : {Isa::scalar, Isa::sse2, Isa::avx2}) {
+        if (static_cast<int>(isa) > static_cast<int>(Scan::best()))
+            break;
+        runs(isa, Scan::space, "space", indented);
+        runs(isa, Scan::word, "word ", program);
+        runs(isa, Scan::line, "line ", program);
+    }
+
+    double secs = Bench::best_of(5, [&] {
+        size_t n = 0;
+        for (Lexer lex(program); !lex.empty(); ++lex) n++;
+        Bench::keep(n);
+    });
+    Util::write(std::cout, "Lexer", program.size() / secs / 1e6, "MB/s");
+}
@@ -0,0 +1,49 @@
+#include "bench.h"
+#include "generate.h"
+#include "lexer.h"
+#include "parser.h"
+#include <string>
+
+int main()
+{
+    std::string const program = Bench::generate(200, 20);
+    double const      mb      = program.size() / 1e6;
+
+    TokenBuffer const buffer(program);
+    size_t const      per_token =
+        sizeof(Lexeme) + 3 * sizeof(uint32_t) + sizeof(Symbol);
+    Util::write(std::cout, "tokens", buffer.size(), "in", mb, "MB");
+    Util::write(std::cout, "TokenBuffer", per_token,
+                "bytes per token, LexState", sizeof(LexState));
+
+    double ring = Bench::best_of(5, [&] {
+        size_t n = 0;
+        for (Lexer lex(program, 2); !lex.empty(); ++lex)
+            n += Lexeme(lex[1]) == Lexeme::identifier;
+        Bench::keep(n);
+    });
+    Util::write(std::cout, "Lexer ring   ", mb / ring, "MB/s");
+
+    double up_front = Bench::best_of(5, [&] {
+        TokenBuffer tokens(program);
+        Bench::keep(tokens.size());
+    });
+    Util::write(std::cout, "TokenBuffer  ", mb / up_front, "MB/s");
+
+    std::string const large = Bench::generate(2000, 20);
+    for (unsigned threads : {1, 2, 4, 8}) {
+        double secs = Bench::best_of(3, [&] {
+            TokenBuffer tokens(large, threads);
+            Bench::keep(tokens.size());
+        });
+        Util::write(std::cout, "TokenBuffer", threads, "threads",
+                    large.size() / 1e6 / secs, "MB/s");
+    }
+
+    double parse = Bench::best_of(5, [&] {
+        Parser parser("bench", std::string_view(program));
+        auto   ast = parser.Program();
+        Bench::keep(ast);
+    });
+    Util::write(std::cout, "lex and parse", mb / parse, "MB/s");
+}
@@ -0,0 +1,42 @@
+#include "IR.h"
+#include "bench.h"
+#include "generate.h"
+#include "helper.h"
+#include "parser.h"
+#include "translate.h"
+#include "typecheck.h"
+#include <string>
+
+int main()
+{
+    std::string const program = Bench::generate(2000, 10);
+    Parser            parser("bench", std::string_view(program));
+    auto const        ast = parser.Program();
+
+    for (unsigned threads : {1u, 0u}) {
+        char const* mode = threads == 1 ? "(serial)" : "(parallel)";
+
+        double layout = Bench::best_of(5, [&] {
+            helper::meta_data data(ast, threads);
+            Bench::keep(data);
+        });
+        Util::write(std::cout, "class layouts", mode, layout * 1e3,
+                    "ms");
+
+        helper::meta_data data(ast);
+        double            check = Bench::best_of(5, [&] {
+            IR::TypeChecker types(data, ast, threads);
+            Bench::keep(types);
+        });
+        Util::write(std::cout, "type checking", mode, check * 1e3,
+                    "ms");
+
+        double translate = Bench::best_of(5, [&] {
+            IR::Tree tree;
+            IR::translate(tree, ast, threads);
+            Bench::keep(tree);
+        });
+        Util::write(std::cout, "translation", mode, translate * 1e3,
+                    "ms");
+    }
+}
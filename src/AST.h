@@ -3,10 +3,12 @@
 
 #include "grammar.h"
 #include "lexer.h"
+#include "symbol.h"
 #include "util.h"
 #include <algorithm>
 #include <memory>
 #include <string>
+#include <tuple>
 #include <variant>
 #include <vector>
 #define UNREACHABLE() (__builtin_unreachable())
@@ -115,9 +117,9 @@ struct lengthExp : __detail::UnaryRule<Exp> {
 };
 
 struct methodCallExp : Grammar::Indexable {
-    Exp         object;
-    std::string name;
-    ExpList     arguments;
+    Exp     object;
+    Symbol  name;
+    ExpList arguments;
 
     methodCallExp(Builder&&);
 };
@@ -125,11 +127,11 @@ struct methodCallExp : Grammar::Indexable {
 struct integerExp : __detail::ValueWrapper<int32_t> {
     using __detail::ValueWrapper<int32_t>::ValueWrapper;
 };
-struct identifierExp : __detail::ValueWrapper<std::string> {
-    using __detail::ValueWrapper<std::string>::ValueWrapper;
+struct identifierExp : __detail::ValueWrapper<Symbol> {
+    using __detail::ValueWrapper<Symbol>::ValueWrapper;
 };
-struct newObjectExp : __detail::ValueWrapper<std::string> {
-    using __detail::ValueWrapper<std::string>::ValueWrapper;
+struct newObjectExp : __detail::ValueWrapper<Symbol> {
+    using __detail::ValueWrapper<Symbol>::ValueWrapper;
 };
 
 struct trueExp : __detail::TagRule {
@@ -201,16 +203,16 @@ struct printStm : Grammar::Indexable {
 };
 
 struct assignStm : Grammar::Indexable {
-    std::string name;
-    Exp         value;
+    Symbol name;
+    Exp    value;
 
     assignStm(Builder&&);
 };
 
 struct indexAssignStm : Grammar::Indexable {
-    std::string array;
-    Exp         index;
-    Exp         value;
+    Symbol array;
+    Exp    index;
+    Exp    value;
 
     indexAssignStm(Builder&&);
 };
@@ -224,8 +226,8 @@ struct booleanType : __detail::TagRule {
 struct integerType : __detail::TagRule {
     using __detail::TagRule::TagRule;
 };
-struct classType : __detail::ValueWrapper<std::string> {
-    using __detail::ValueWrapper<std::string>::ValueWrapper;
+struct classType : __detail::ValueWrapper<Symbol> {
+    using __detail::ValueWrapper<Symbol>::ValueWrapper;
 };
 
 // clang-format off
@@ -238,20 +240,17 @@ struct Type : Grammar::Nonterminal<std::variant<
 // clang-format on
 {
     using Grammar::Nonterminal<Type::variant_t>::Nonterminal;
-    Type(Type const& rhs)
-        : Grammar::Nonterminal<Type::variant_t>(*rhs._self)
+    Type(Type const& rhs) : Grammar::Nonterminal<Type::variant_t>(rhs)
     {
     }
-    Type& operator=(Type const& rhs)
-    {
-        _self = std::make_unique<Type::variant_t>(*rhs._self);
-        return *this;
-    }
+    Type(Type&&)            = default;
+    Type& operator=(Type&&) = default;
+    Type& operator=(Type const& rhs) { return *this = Type(rhs); }
 };
 
 struct FormalDecl {
-    Type        type;
-    std::string name;
+    Type   type;
+    Symbol name;
 };
 
 struct FormalListRule : Grammar::Indexable {
@@ -266,8 +265,8 @@ struct FormalList
 };
 
 struct VarDeclRule : Grammar::Indexable {
-    Type        type;
-    std::string name;
+    Type   type;
+    Symbol name;
 
     VarDeclRule(Builder&&);
 };
@@ -278,7 +277,7 @@ struct VarDecl : Grammar::Nonterminal<std::variant<VarDeclRule>> {
 
 struct MethodDeclRule : Grammar::Indexable {
     Type                 type;
-    std::string          name;
+    Symbol               name;
     FormalList           arguments;
     std::vector<VarDecl> variables;
     std::vector<Stm>     body;
@@ -293,7 +292,7 @@ struct MethodDecl
 };
 
 struct ClassDeclNoInheritance : Grammar::Indexable {
-    std::string             name;
+    Symbol                  name;
     std::vector<VarDecl>    variables;
     std::vector<MethodDecl> methods;
 
@@ -301,8 +300,8 @@ struct ClassDeclNoInheritance : Grammar::Indexable {
 };
 
 struct ClassDeclInheritance : Grammar::Indexable {
-    std::string             name;
-    std::string             superclass;
+    Symbol                  name;
+    Symbol                  superclass;
     std::vector<VarDecl>    variables;
     std::vector<MethodDecl> methods;
 
@@ -319,9 +318,9 @@ using Grammar::Nonterminal<ClassDecl::variant_t>::Nonterminal;
 // clang-format on
 
 struct MainClassRule : Grammar::Indexable {
-    std::string name;
-    std::string argument;
-    Stm         body;
+    Symbol name;
+    Symbol argument;
+    Stm    body;
 
     MainClassRule(Builder&&);
 };
@@ -356,11 +355,21 @@ struct WrongIdentifier {
 };
 
 struct ParsingError {
-    std::vector<std::string>                            ctx;
+    std::vector<Symbol>                                 ctx;
     std::vector<int>                                    lines;
     std::variant<Unexpected, Mismatch, WrongIdentifier> inner;
 };
 
 using ErrorData = std::vector<std::unique_ptr<ParsingError>>;
+
+// Children of the rules being parsed, one stack per type. It belongs
+// to the Parser and is shared by every Builder, see Builder.h.
+using Scratch =
+    std::tuple<std::vector<MainClass>, std::vector<Symbol>,
+               std::vector<ClassDecl>, std::vector<VarDecl>,
+               std::vector<MethodDecl>, std::vector<Type>,
+               std::vector<Exp>, std::vector<Stm>,
+               std::vector<FormalList>, std::vector<ExpList>,
+               std::vector<int32_t>, std::vector<Lexeme>>;
 } // namespace AST
 #endif
@@ -0,0 +1,261 @@
+#ifndef BCC_ASTCATAMORPHISM
+#define BCC_ASTCATAMORPHISM
+
+#include "AST.h"
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace AST
+{
+// The id of whatever node nt holds
+template <typename nt_t> int id(nt_t const& nt)
+{
+    auto get = [](auto const& node) { return node.id; };
+    return Grammar::visit(get, nt);
+}
+
+// The children of every rule, in source order. push is called once
+// per child Nonterminal.
+// clang-format off
+template <typename P> void children(__detail::TagRule const&, P&&) {}
+template <typename T, typename P>
+void children(__detail::ValueWrapper<T> const&, P&&) {}
+// clang-format on
+
+template <typename nt_t, typename P>
+void children(__detail::BinaryRule<nt_t> const& node, P&& push)
+{
+    push(node.lhs);
+    push(node.rhs);
+}
+
+template <typename nt_t, typename P>
+void children(__detail::UnaryRule<nt_t> const& node, P&& push)
+{
+    push(node.inner);
+}
+
+template <typename P>
+void children(methodCallExp const& node, P&& push)
+{
+    push(node.object);
+    push(node.arguments);
+}
+
+template <typename P> void children(ExpListRule const& node, P&& push)
+{
+    for (auto const& e : node.exps) push(e);
+}
+
+template <typename P> void children(blockStm const& node, P&& push)
+{
+    for (auto const& s : node.statements) push(s);
+}
+
+template <typename P> void children(ifStm const& node, P&& push)
+{
+    push(node.condition);
+    push(node.if_clause);
+    push(node.else_clause);
+}
+
+template <typename P> void children(whileStm const& node, P&& push)
+{
+    push(node.condition);
+    push(node.body);
+}
+
+template <typename P> void children(printStm const& node, P&& push)
+{
+    push(node.exp);
+}
+
+template <typename P> void children(assignStm const& node, P&& push)
+{
+    push(node.value);
+}
+
+template <typename P>
+void children(indexAssignStm const& node, P&& push)
+{
+    push(node.index);
+    push(node.value);
+}
+
+template <typename P>
+void children(FormalListRule const& node, P&& push)
+{
+    for (auto const& d : node.decls) push(d.type);
+}
+
+template <typename P> void children(VarDeclRule const& node, P&& push)
+{
+    push(node.type);
+}
+
+template <typename P>
+void children(MethodDeclRule const& node, P&& push)
+{
+    push(node.type);
+    push(node.arguments);
+    for (auto const& v : node.variables) push(v);
+    for (auto const& s : node.body) push(s);
+    push(node.return_exp);
+}
+
+template <typename P>
+void children(ClassDeclNoInheritance const& node, P&& push)
+{
+    for (auto const& v : node.variables) push(v);
+    for (auto const& m : node.methods) push(m);
+}
+
+template <typename P>
+void children(ClassDeclInheritance const& node, P&& push)
+{
+    for (auto const& v : node.variables) push(v);
+    for (auto const& m : node.methods) push(m);
+}
+
+template <typename P>
+void children(MainClassRule const& node, P&& push)
+{
+    push(node.body);
+}
+
+template <typename P> void children(ProgramRule const& node, P&& push)
+{
+    push(node.main);
+    for (auto const& c : node.classes) push(c);
+}
+
+// The AST counterpart of IR::Catamorphism. f is applied once to every
+// node below root, children before their parents, and what it returns
+// is kept in a dense array indexed by node id; f gets the results of
+// the children through fmap.
+//
+// Unlike the IR one, this is not a sweep over the ids. The parser
+// hands out ids in pre-order, except that a binary operator gets its
+// id after both operands: precedence climbing only knows it has an
+// operator once the left operand is parsed. So no order of the ids
+// puts every child before its parent. Instead this is a post-order
+// walk with an explicit stack, which does not recurse however deep
+// the tree is. Each node on the stack carries three function
+// pointers for its rule.
+//
+// If f has an enter(node) overload for some rule, it is called before
+// any of that node's children, which is how f can keep track of, say,
+// the method it is in.
+//
+// A walk over a class, whose nodes all have ids after its own, can
+// start the array at the id of the class rather than at 0.
+struct from_id {
+    int value;
+};
+
+template <template <typename C> typename F, typename R>
+struct Catamorphism {
+    struct rec_t {
+        Catamorphism* self;
+        R operator()(int id) const
+        {
+            return self->x[id - self->base];
+        }
+    };
+
+    int            base;
+    std::vector<R> x;
+    F<rec_t>       f;
+
+    template <typename Root, typename... Args>
+    Catamorphism(Root const& root, Args&&... args)
+        : Catamorphism(from_id{0}, root, std::forward<Args>(args)...)
+    {
+    }
+
+    template <typename Root, typename... Args>
+    Catamorphism(from_id first, Root const& root, Args&&... args)
+        : base(first.value),
+          f(rec_t{this}, std::forward<Args>(args)...)
+    {
+        std::vector<std::pair<Ref, bool>> stack;
+        std::vector<Ref>                  kids;
+        stack.push_back({root_ref(root, nullptr), false});
+        while (!stack.empty()) {
+            auto [top, expanded] = stack.back();
+            if (expanded) {
+                stack.pop_back();
+                size_t const at = top.id - base;
+                if (at >= x.size()) x.resize(at + 1);
+                x[at] = top.apply(f, top.node);
+                continue;
+            }
+            stack.back().second = true;
+            top.enter(f, top.node);
+            kids.clear();
+            top.expand(top.node, kids);
+            for (auto it = kids.rbegin(); it != kids.rend(); ++it)
+                stack.push_back({*it, false});
+        }
+    }
+
+    // f holds a pointer back to this
+    Catamorphism(Catamorphism const&) = delete;
+
+    R operator()(int id) { return x[id - base]; }
+
+  private:
+    struct Ref {
+        void const* node;
+        int         id;
+        void (*expand)(void const*, std::vector<Ref>&);
+        void (*enter)(F<rec_t>&, void const*);
+        R (*apply)(F<rec_t>&, void const*);
+    };
+
+    template <typename G, typename T>
+    static auto enter(G& f, T const& node, int)
+        -> decltype(f.enter(node))
+    {
+        return f.enter(node);
+    }
+    template <typename G, typename T>
+    static void enter(G&, T const&, long)
+    {
+    }
+
+    template <typename T> static Ref ref(T const& node)
+    {
+        auto expand = [](void const* n, std::vector<Ref>& out) {
+            auto push = [&](auto const& c) { out.push_back(of(c)); };
+            children(*static_cast<T const*>(n), push);
+        };
+        auto enter = [](F<rec_t>& f, void const* n) {
+            Catamorphism::enter(f, *static_cast<T const*>(n), 0);
+        };
+        auto apply = [](F<rec_t>& f, void const* n) -> R {
+            return f(*static_cast<T const*>(n));
+        };
+        return {&node, node.id, expand, enter, apply};
+    }
+
+    template <typename nt_t> static Ref of(nt_t const& nt)
+    {
+        auto get = [](auto const& node) { return ref(node); };
+        return Grammar::visit(get, nt);
+    }
+
+    template <typename T>
+    static Ref root_ref(T const& root, decltype(root.id)* = nullptr)
+    {
+        return ref(root);
+    }
+    template <typename T> static Ref root_ref(T const& root, ...)
+    {
+        return of(root);
+    }
+};
+} // namespace AST
+
+#endif
@@ -1,28 +1,40 @@
 #include "Builder.h"
+#include <charconv>
+#include <utility>
 namespace AST {
 
 Builder::Builder(Parser& __parser)
-    : parser(__parser), id(parser.idx++) {
-    parser.errors.push_back({});
+    : parser(__parser),
+      outer(std::exchange(Grammar::Arena::current(), &parser.nodes)),
+      id(parser.idx++) {
+    std::apply(
+        [&](auto const&... s) { base = {uint32_t(s.size())...}; },
+        parser.scratch);
 }
 
-Builder::Builder(Parser& __parser, std::string label)
-    : parser(__parser), id(parser.idx++) {
-    parser.errors.push_back({});
+Builder::Builder(Parser& __parser, Symbol label)
+    : Builder(__parser) {
     parser.record_context(label);
     pop = true;
 }
 
 Builder::~Builder() {
+    cut(std::make_index_sequence<kinds>());
     if (pop) parser.drop_context();
+    Grammar::Arena::current() = outer;
 }
 
 Builder& Builder::operator<<(Lexeme lex) {
-    if (Lexeme(parser[0]) != lex) parser.mismatch(lex, id);
+    if (parser.tokens.kind() != lex) parser.mismatch(lex, id);
+    auto const tok  = parser[0];
+    auto const word = tok.second;
     if (Lexeme::identifier == lex)
-        _keep(parser[0].second);
-    else if (Lexeme::integer_literal == lex)
-        _keep(std::stoi(parser[0].second));
+        _keep(tok.fourth);
+    else if (Lexeme::integer_literal == lex) {
+        int32_t value = 0;
+        std::from_chars(word.data(), word.data() + word.size(), value);
+        _keep(value);
+    }
     ++parser.tokens;
     return *this;
 }
@@ -35,8 +47,6 @@ Builder& Builder::operator<<(std::string in) {
 
 void Builder::unexpected(Lexeme un) { parser.unexpected(un, id); }
 
-Exp Builder::lhs() { return std::move(claim<Exp>(*this).at(0)); }
-
 namespace __detail {
 
 TagRule::TagRule(Builder&& data) : Grammar::Indexable{data.id} {}
@@ -57,7 +67,7 @@ template <typename T>
 ValueWrapper<T>::ValueWrapper(Builder&& data)
     : Grammar::Indexable{data.id}, value(claim<T>(data, 0)) {}
 template struct ValueWrapper<int32_t>::ValueWrapper;
-template struct ValueWrapper<std::string>::ValueWrapper;
+template struct ValueWrapper<Symbol>::ValueWrapper;
 } // namespace __detail
 
 ExpListRule::ExpListRule(Builder&& data)
@@ -65,7 +75,7 @@ ExpListRule::ExpListRule(Builder&& data)
 
 methodCallExp::methodCallExp(Builder&& data)
     : Grammar::Indexable{data.id}, object(claim<Exp>(data, 0)),
-      name(claim<std::string>(data, 0)),
+      name(claim<Symbol>(data, 0)),
       arguments(claim<ExpList>(data, 0)) {}
 
 blockStm::blockStm(Builder&& data)
@@ -84,11 +94,11 @@ printStm::printStm(Builder&& data)
     : Grammar::Indexable{data.id}, exp(claim<Exp>(data, 0)) {}
 
 assignStm::assignStm(Builder&& data)
-    : Grammar::Indexable{data.id}, name(claim<std::string>(data, 0)),
+    : Grammar::Indexable{data.id}, name(claim<Symbol>(data, 0)),
       value(claim<Exp>(data, 0)) {}
 
 indexAssignStm::indexAssignStm(Builder&& data)
-    : Grammar::Indexable{data.id}, array(claim<std::string>(data, 0)),
+    : Grammar::Indexable{data.id}, array(claim<Symbol>(data, 0)),
       index(claim<Exp>(data, 0)), value(claim<Exp>(data, 1)) {}
 
 FormalListRule::FormalListRule(Builder&& data)
@@ -96,7 +106,7 @@ FormalListRule::FormalListRule(Builder&& data)
     std::vector<FormalDecl> D;
 
     auto T = claim<Type>(data);
-    auto W = claim<std::string>(data);
+    auto W = claim<Symbol>(data);
 
     int s = std::min(T.size(), W.size());
     for (int i = 0; i < s; i++)
@@ -108,29 +118,29 @@ FormalListRule::FormalListRule(Builder&& data)
 
 VarDeclRule::VarDeclRule(Builder&& data)
     : Grammar::Indexable{data.id}, type(claim<Type>(data, 0)),
-      name(claim<std::string>(data, 0)) {}
+      name(claim<Symbol>(data, 0)) {}
 
 MethodDeclRule::MethodDeclRule(Builder&& data)
     : Grammar::Indexable{data.id}, type(claim<Type>(data, 0)),
-      name(claim<std::string>(data, 0)),
+      name(claim<Symbol>(data, 0)),
       arguments(claim<FormalList>(data, 0)),
       variables(claim<VarDecl>(data)), body(claim<Stm>(data)),
       return_exp(claim<Exp>(data, 0)) {}
 
 ClassDeclNoInheritance::ClassDeclNoInheritance(Builder&& data)
-    : Grammar::Indexable{data.id}, name(claim<std::string>(data, 0)),
+    : Grammar::Indexable{data.id}, name(claim<Symbol>(data, 0)),
       variables(claim<VarDecl>(data)),
       methods(claim<MethodDecl>(data)) {}
 
 ClassDeclInheritance::ClassDeclInheritance(Builder&& data)
-    : Grammar::Indexable{data.id}, name(claim<std::string>(data, 0)),
-      superclass(claim<std::string>(data, 1)),
+    : Grammar::Indexable{data.id}, name(claim<Symbol>(data, 0)),
+      superclass(claim<Symbol>(data, 1)),
       variables(claim<VarDecl>(data)),
       methods(claim<MethodDecl>(data)) {}
 
 MainClassRule::MainClassRule(Builder&& data)
-    : Grammar::Indexable{data.id}, name(claim<std::string>(data, 0)),
-      argument(claim<std::string>(data, 1)),
+    : Grammar::Indexable{data.id}, name(claim<Symbol>(data, 0)),
+      argument(claim<Symbol>(data, 1)),
       body(claim<Stm>(data, 0)) {}
 
 ProgramRule::ProgramRule(Builder&& data)
@@ -3,31 +3,51 @@
 #include "AST.h"
 #include "lexer.h"
 #include "parser.h"
+#include <array>
+#include <type_traits>
 
 namespace AST {
 
+// Collects the children of one rule on the parser's Scratch stacks.
+// Builders nest exactly like the rules that make them, so a Builder
+// only ever sees the top of each stack, from base up. Its destructor
+// cuts the stacks back to base, which keeps their capacity around
+// for the next rule: parsing does not allocate to build a node.
+// While a Builder is alive, the nodes made on its thread go to the
+// arena of its parser.
 class Builder {
-    using inner_t =
-        std::tuple<std::vector<MainClass>, std::vector<std::string>,
-                   std::vector<ClassDecl>, std::vector<VarDecl>,
-                   std::vector<MethodDecl>, std::vector<Type>,
-                   std::vector<Exp>, std::vector<Stm>,
-                   std::vector<FormalList>, std::vector<ExpList>,
-                   std::vector<int32_t>>;
+    static constexpr size_t kinds = std::tuple_size_v<Scratch>;
 
-    Parser& parser;
-    bool    pop = false;
+    template <typename T, size_t k = 0>
+    static constexpr size_t slot() {
+        using U = std::tuple_element_t<k, Scratch>;
+        if constexpr (std::is_same_v<U, std::vector<T>>)
+            return k;
+        else
+            return slot<T, k + 1>();
+    }
+
+    template <size_t... k> void cut(std::index_sequence<k...>) {
+        auto& s = parser.scratch;
+        (std::get<k>(s).erase(std::get<k>(s).begin() + base[k],
+                              std::get<k>(s).end()),
+         ...);
+    }
 
     template <typename T> void _keep(T&& in) {
-        using U = std::vector<std::decay_t<T>>;
-        std::get<U>(inner).push_back(std::forward<T>(in));
+        stack<std::decay_t<T>>().push_back(std::forward<T>(in));
     }
 
+    Parser&                     parser;
+    bool                        pop = false;
+    std::array<uint32_t, kinds> base;
+    Grammar::Arena*             outer;
+
   public:
-    int     id;
-    inner_t inner;
+    int id;
     Builder(Parser& __parser);
-    Builder(Parser& __parser, std::string label);
+    Builder(Parser& __parser, Symbol label);
+    Builder(Builder const&) = delete;
     ~Builder();
     Builder& operator<<(Lexeme lex);
     Builder& operator<<(std::string in);
@@ -38,17 +58,24 @@ class Builder {
         return *this;
     }
 
-    Exp lhs();
+    template <typename T> std::vector<T>& stack() {
+        return std::get<slot<T>()>(parser.scratch);
+    }
+
+    template <typename T> size_t from() const {
+        return base[slot<T>()];
+    }
 };
 
 template <typename T> std::vector<T> claim(Builder& data) {
-    using U = std::vector<std::decay_t<T>>;
-    return std::move(std::get<U>(data.inner));
+    auto& s  = data.stack<T>();
+    auto  lo = s.begin() + data.from<T>();
+    return std::vector<T>(std::make_move_iterator(lo),
+                          std::make_move_iterator(s.end()));
 }
 
 template <typename T> T claim(Builder& data, size_t i) {
-    using U = std::vector<std::decay_t<T>>;
-    return std::move(std::get<U>(data.inner).at(i));
+    return std::move(data.stack<T>().at(data.from<T>() + i));
 }
 
 } // namespace AST
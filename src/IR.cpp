@@ -1,78 +1,55 @@
 #include "IR.h"
 
-static void check_id(int found, int expected)
-{
-    if (found != expected) throw IR::BadAccess{found, expected};
-}
-
 namespace IR
 {
-#define IR_GETTER(name, ID, ret)                                     \
-    ret& Tree::get##name(int ref)                                    \
-    {                                                                \
-        check_id(kind[ref], static_cast<int>(ID));                   \
-        return name[pos[ref]];                                       \
-    }                                                                \
-    ret const& Tree::get##name(int ref) const                        \
-    {                                                                \
-        check_id(kind[ref], static_cast<int>(ID));                   \
-        return name[pos[ref]];                                       \
-    }
-
-IR_GETTER(_const, IRTag::CONST, Const)
-IR_GETTER(_reg, IRTag::REG, Reg)
-IR_GETTER(_temp, IRTag::TEMP, Temp)
-IR_GETTER(_binop, IRTag::BINOP, Binop)
-IR_GETTER(_mem, IRTag::MEM, Mem)
-IR_GETTER(_call, IRTag::CALL, Call)
-IR_GETTER(_move, IRTag::MOVE, Move)
-IR_GETTER(_exp, IRTag::EXP, Exp)
-IR_GETTER(_jmp, IRTag::JMP, Jmp)
-IR_GETTER(_label, IRTag::LABEL, Label)
-IR_GETTER(_cmp, IRTag::CMP, Cmp)
-IR_GETTER(_cjmp, IRTag::CJMP, Cjmp)
-IR_GETTER(_push, IRTag::PUSH, Push)
-IR_GETTER(_pop, IRTag::POP, Pop)
-
-#undef IR_GETTER
-
 Tree::Tree() : tmp(0), lbl(0) {}
 
-size_t Tree::size() const { return pos.size(); }
+size_t Tree::size() const { return kind.size(); }
 
-IRTag Tree::get_type(int ref) const
+size_t Tree::bytes() const
 {
-    return static_cast<IRTag>(kind[ref]);
+    size_t ans = kind.size() * sizeof(IRTag);
+    ans += slot.size() * sizeof(Slot);
+    ans += _binop.size() * sizeof(Binop);
+    ans += _call.size() * sizeof(Call);
+    ans += _cmp.size() * sizeof(Cmp);
+    ans += _move.size() * sizeof(Move);
+    ans += _cjmp.size() * sizeof(Cjmp);
+    return ans;
 }
 
-Explist Tree::get_explist(int ref) const { return _explist[ref]; }
+int Tree::add(IRTag tag, Slot s)
+{
+    kind.push_back(tag);
+    slot.push_back(s);
+    return slot.size() - 1;
+}
 
-int Tree::keep_explist(Explist&& els)
+Explist Tree::get_explist(int ref) const
 {
-    int ans = _explist.size();
-    _explist.push_back(els);
-    return ans;
+    auto const [at, length] = _explist[ref];
+    return Explist(_explist_pool.data() + at, length);
 }
 
-int Tree::new_temp()
+int Tree::keep_explist(size_t from)
 {
-    auto ref = pos.size();
-    kind.push_back(static_cast<int>(IRTag::TEMP));
-    pos.push_back(_temp.size());
-    _temp.push_back(Temp{tmp++});
-    return ref;
+    int const ans = _explist.size();
+    int const at  = _explist_pool.size();
+    _explist.push_back({at, _pending.size() - from});
+    _explist_pool.insert(_explist_pool.end(), _pending.begin() + from,
+                         _pending.end());
+    _pending.resize(from);
+    return ans;
 }
 
+int Tree::new_temp() { return add(IRTag::TEMP, Temp{tmp++}); }
+
 label_handle::label_handle(int _ref) : ref(_ref) {}
 label_handle::operator int() const { return ref; }
 
 label_handle Tree::new_label()
 {
-    auto ref = pos.size();
-    kind.push_back(static_cast<int>(IRTag::LABEL));
-    pos.push_back(_label.size());
-    _label.push_back(Label{lbl++});
-    return ref;
+    return add(IRTag::LABEL, Label{lbl++});
 }
 
 int Tree::place_label(label_handle&& lbl)
@@ -81,6 +58,93 @@ int Tree::place_label(label_handle&& lbl)
     return lbl.ref;
 }
 
+void Tree::append(Tree const& part)
+{
+    int const n      = size();
+    int const binops = _binop.size(), calls = _call.size();
+    int const cmps = _cmp.size(), moves = _move.size();
+    int const cjmps = _cjmp.size();
+
+    for (size_t i = 0; i < part.size(); i++) {
+        Slot s = part.slot[i];
+        switch (part.kind[i]) {
+        case IRTag::CONST:
+        case IRTag::REG:
+            break;
+        case IRTag::TEMP:
+            s.t.id += tmp;
+            break;
+        case IRTag::LABEL:
+            s.l.id += lbl;
+            break;
+        case IRTag::MEM:
+            s.m.exp += n;
+            break;
+        case IRTag::EXP:
+            s.e.exp += n;
+            break;
+        case IRTag::JMP:
+            s.j.target += n;
+            break;
+        case IRTag::PUSH:
+            s.push.ref += n;
+            break;
+        case IRTag::POP:
+            s.pop.ref += n;
+            break;
+        case IRTag::BINOP:
+            s.index.pos += binops;
+            break;
+        case IRTag::CALL:
+            s.index.pos += calls;
+            break;
+        case IRTag::CMP:
+            s.index.pos += cmps;
+            break;
+        case IRTag::MOVE:
+            s.index.pos += moves;
+            break;
+        case IRTag::CJMP:
+            s.index.pos += cjmps;
+            break;
+        }
+        add(part.kind[i], s);
+    }
+
+    int const exps = _explist.size();
+    int const ids  = _explist_pool.size();
+    for (auto [at, length] : part._explist)
+        _explist.push_back({at + ids, length});
+    for (int ref : part._explist_pool)
+        _explist_pool.push_back(ref + n);
+
+    for (auto const& b : part._binop)
+        _binop.push_back({b.op, b.lhs + n, b.rhs + n});
+    for (auto const& c : part._call)
+        _call.push_back({c.fn, c.explist + exps});
+    for (auto const& c : part._cmp)
+        _cmp.push_back({c.lhs + n, c.rhs + n});
+    for (auto const& m : part._move)
+        _move.push_back({m.dst + n, m.src + n});
+    for (auto const& c : part._cjmp)
+        _cjmp.push_back({c.temp + n, c.target + n});
+
+    tmp += part.tmp;
+    lbl += part.lbl;
+
+    for (int s : part.stm_seq) stm_seq.push_back(s + n);
+    for (auto const& mtd : part.methods) {
+        fragment frag = mtd.second;
+        frag.stack.sp += n;
+        frag.stack.tp += n;
+        for (auto& a : frag.stack.arguments) a.second += n;
+        for (auto& s : frag.stms) s += n;
+        methods.insert({mtd.first, std::move(frag)});
+    }
+    for (auto const& a : part.aliases)
+        aliases[a.first].insert(a.second.begin(), a.second.end());
+}
+
 void Tree::simplify()
 {
     spill();
@@ -91,9 +155,8 @@ void Tree::mark_sp()
 {
     for (auto const& mtd : methods) {
         int sp   = mtd.second.stack.sp;
-        kind[sp] = static_cast<int>(IRTag::REG);
-        pos[sp]  = _reg.size();
-        _reg.push_back(Reg{0});
+        kind[sp] = IRTag::REG;
+        slot[sp] = Reg{0};
     }
 }
 
@@ -102,7 +165,7 @@ void Tree::spill()
     std::vector<int> v;
     std::vector<int> fs(methods.size());
     for (auto const& mtd : methods) v.push_back(mtd.second.stack.sp);
-    v.push_back(pos.size());
+    v.push_back(size());
     std::sort(begin(v), end(v));
 
     for (auto& mtd : methods) {
@@ -112,30 +175,28 @@ void Tree::spill()
         fs[i]  = mtd.second.stack.spill_size;
     }
 
+    // Nodes are visited in order, so the method of node i, the last
+    // one in v to start at or before i, only ever moves forward
     std::vector<int> max_id(v.size());
-    for (int i = 0; i < static_cast<int>(pos.size()); i++)
-        if (kind[i] == static_cast<int>(IRTag::TEMP)) {
-            auto it     = std::prev(upper_bound(begin(v), end(v), i));
-            int  j      = *it;
-            int  _id    = std::distance(begin(v), it);
-            max_id[_id] = std::max(max_id[_id], get_temp(i).id);
+    int              _id = 0;
+    for (int i = 0; i < static_cast<int>(size()); i++)
+        if (kind[i] == IRTag::TEMP) {
+            while (v[_id + 1] <= i) _id++;
+            int j      = v[_id];
+            int tmp_id = get_temp(i).id;
+            max_id[_id] = std::max(max_id[_id], tmp_id);
 
             if (i == j) continue;
 
-            int cte = pos.size();
-            kind.push_back(static_cast<int>(IRTag::CONST));
-            pos.push_back(_const.size());
-            _const.push_back(Const{
-                fs[j] + 8 * (get_temp(i).id - (get_temp(j).id + 1))});
+            int cte = add(
+                IRTag::CONST,
+                Const{fs[_id] + 8 * (tmp_id - (get_temp(j).id + 1))});
 
-            int binop = pos.size();
-            kind.push_back(static_cast<int>(IRTag::BINOP));
-            pos.push_back(_binop.size());
+            int binop = add(IRTag::BINOP, Index{int(_binop.size())});
             _binop.push_back(Binop{BinopId::PLUS, j, cte});
 
-            kind[i] = static_cast<int>(IRTag::MEM);
-            pos[i]  = _mem.size();
-            _mem.push_back(Mem{binop});
+            kind[i] = IRTag::MEM;
+            slot[i] = Mem{binop};
         }
 
     for (auto& mtd : methods) {
@@ -149,11 +210,9 @@ void Tree::spill()
 
 void Tree::fix_registers(int k)
 {
-    base_register = pos.size();
+    base_register = size();
     for (int i = 0; i < k; i++) {
-        kind.push_back(static_cast<int>(IRTag::REG));
-        pos.push_back(_reg.size());
-        _reg.push_back(Reg{i});
+        add(IRTag::REG, Reg{i});
     }
 }
 
@@ -166,6 +225,72 @@ int is_exp(IRTag tag)
 
 size_t fragment::size() const { return stms.size(); }
 
+fragment_table::const_iterator
+fragment_table::lower_bound(Symbol s) const
+{
+    auto less = [](value_type const& x, Symbol y) {
+        return Symbol::by_name()(x.first, y);
+    };
+    return std::lower_bound(v.begin(), v.end(), s, less);
+}
+
+// The labels from v[from] on have moved
+void fragment_table::reindex(size_t from)
+{
+    for (size_t i = from; i < v.size(); i++)
+        pos[v[i].first.index()] = i;
+}
+
+fragment_table::const_iterator fragment_table::find(Symbol s) const
+{
+    size_t const id = s.index();
+    if (id >= pos.size() || pos[id] == -1) return v.end();
+    return v.begin() + pos[id];
+}
+
+fragment_table::iterator fragment_table::find(Symbol s)
+{
+    return v.begin() + (std::as_const(*this).find(s) - v.cbegin());
+}
+
+size_t fragment_table::count(Symbol s) const
+{
+    return find(s) != end();
+}
+
+fragment& fragment_table::operator[](Symbol s)
+{
+    return insert({s, fragment{}}).first->second;
+}
+
+fragment const& fragment_table::at(Symbol s) const
+{
+    auto it = find(s);
+    if (it == end()) throw std::out_of_range("fragment_table::at");
+    return it->second;
+}
+
+std::pair<fragment_table::iterator, bool>
+fragment_table::insert(value_type&& x)
+{
+    if (auto it = find(x.first); it != v.end()) return {it, false};
+    size_t const id = x.first.index();
+    if (id >= pos.size()) pos.resize(id + 1, -1);
+    size_t const at = lower_bound(x.first) - v.cbegin();
+    v.insert(v.begin() + at, std::move(x));
+    reindex(at);
+    return {v.begin() + at, true};
+}
+
+fragment_table::iterator fragment_table::erase(iterator it)
+{
+    size_t const at        = it - v.begin();
+    pos[it->first.index()] = -1;
+    v.erase(it);
+    reindex(at);
+    return v.begin() + at;
+}
+
 std::ostream& operator<<(std::ostream& out, Tree& t)
 {
     Catamorphism<ShallowFormat, std::string> F(t);
@@ -173,12 +298,40 @@ std::ostream& operator<<(std::ostream& out, Tree& t)
     return out;
 }
 
-void Tree::dump(std::ostream& out) const
+void Tree::dump(std::ostream& out, unsigned threads) const
 {
-    Catamorphism<DeepFormat, std::string> F(*this);
+    Catamorphism<DeepFormat, std::string> F(in_parallel{threads},
+                                            *this);
     tree_dump(out, *this, F);
 }
 
+levels by_height(Tree const& tree)
+{
+    int const        n = tree.size();
+    std::vector<int> height(n, 0);
+    int              top = -1;
+    for (int i = 0; i < n; i++) {
+        // height[i] may already hold the floor a newer child set
+        int& h = height[i];
+        children(tree, i, [&](int c) {
+            if (c < i) h = std::max(h, height[c] + 1);
+        });
+        children(tree, i, [&](int c) {
+            if (c > i) height[c] = std::max(height[c], h + 1);
+        });
+        top = std::max(top, h);
+    }
+
+    levels ans;
+    ans.first.assign(top + 2, 0);
+    for (int h : height) ans.first[h + 1]++;
+    for (int k = 0; k <= top; k++) ans.first[k + 1] += ans.first[k];
+    ans.nodes.resize(n);
+    std::vector<int> at(ans.first.begin(), ans.first.end() - 1);
+    for (int i = 0; i < n; i++) ans.nodes[at[height[i]]++] = i;
+    return ans;
+}
+
 void Tree::emit(int inst)
 {
     if (!stm_seq.size() || stm_seq.back() != inst)
@@ -1,18 +1,25 @@
 #ifndef BCC_IR
 #define BCC_IR
 
+#include "symbol.h"
+#include "thread_pool.h"
 #include "util.h"
 #include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <functional>
 #include <iostream>
 #include <map>
 #include <ostream>
 #include <set>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 class IRBuilder;
+class ExplistBuilder;
 namespace IR
 {
 
@@ -36,7 +43,7 @@ enum BinopId {
     XOR
 };
 
-enum class IRTag {
+enum class IRTag : uint8_t {
     CONST,
     REG,
     TEMP,
@@ -78,8 +85,8 @@ struct Mem {
 };
 
 struct Call {
-    std::string fn;
-    int         explist;
+    Symbol fn;
+    int    explist;
 };
 
 struct Move {
@@ -117,15 +124,34 @@ struct Pop {
     int ref;
 };
 
-using Explist = std::vector<int>;
+// One expression list of a tree: the ids of its nodes, which live in
+// a pool the tree keeps for all of them. Like an iterator, it is good
+// until the next list is added.
+class Explist
+{
+    int const* first;
+    size_t     length;
+
+  public:
+    Explist(int const* _first, size_t _length)
+        : first(_first), length(_length)
+    {
+    }
+
+    int const* begin() const { return first; }
+    int const* end() const { return first + length; }
+    size_t     size() const { return length; }
+    bool       empty() const { return length == 0; }
+    int        operator[](size_t i) const { return first[i]; }
+};
 
 struct fragmentGuard;
 
 struct activation_record {
-    std::map<std::string, int> arguments;
-    int                        sp;
-    int                        tp;
-    int                        spill_size;
+    std::map<Symbol, int> arguments;
+    int                   sp;
+    int                   tp;
+    int                   spill_size;
 };
 
 struct fragment {
@@ -134,6 +160,41 @@ struct fragment {
     size_t            size() const;
 };
 
+// The fragments of a tree by label, kept in one vector sorted by
+// the spelling of the labels, so they are written out in the same
+// order however the labels were interned. Finding one goes straight
+// to its place through a second vector indexed by the id of the
+// label; a new label shifts the ones after it, a handful per tree.
+class fragment_table
+{
+  public:
+    using value_type     = std::pair<Symbol, fragment>;
+    using iterator       = std::vector<value_type>::iterator;
+    using const_iterator = std::vector<value_type>::const_iterator;
+
+    iterator        begin() { return v.begin(); }
+    iterator        end() { return v.end(); }
+    const_iterator  begin() const { return v.begin(); }
+    const_iterator  end() const { return v.end(); }
+    size_t          size() const { return v.size(); }
+    bool            empty() const { return v.empty(); }
+
+    iterator        find(Symbol);
+    const_iterator  find(Symbol) const;
+    size_t          count(Symbol) const;
+    fragment&       operator[](Symbol);
+    fragment const& at(Symbol) const;
+
+    std::pair<iterator, bool> insert(value_type&&);
+    iterator                  erase(iterator);
+
+  private:
+    std::vector<value_type> v;
+    std::vector<int>        pos;
+    const_iterator          lower_bound(Symbol) const;
+    void                    reindex(size_t from);
+};
+
 class Tree;
 class label_handle
 {
@@ -148,6 +209,7 @@ class label_handle
 class Tree
 {
     friend class ::IRBuilder;
+    friend class ::ExplistBuilder;
     friend struct fragmentGuard;
     friend std::ostream& operator<<(std::ostream&, Tree&);
     template <template <typename C> typename F, typename R>
@@ -158,33 +220,62 @@ class Tree
     int tmp;
     int lbl;
 
-    // Type checking info
-    std::vector<int>     kind;
-    std::vector<int>     pos;
-    std::vector<Explist> _explist;
+    // A node is its tag and one more word. Nodes with a single field
+    // keep it in that word; the others keep where they are in the
+    // vector of their kind. So most nodes take five bytes.
+    struct Index {
+        int pos;
+    };
+    union Slot {
+        Index index;
+        Const c;
+        Reg   r;
+        Temp  t;
+        Mem   m;
+        Exp   e;
+        Jmp   j;
+        Label l;
+        Push  push;
+        Pop   pop;
+
+        Slot() : index{0} {}
+        Slot(Index x) : index(x) {}
+        Slot(Const x) : c(x) {}
+        Slot(Reg x) : r(x) {}
+        Slot(Temp x) : t(x) {}
+        Slot(Mem x) : m(x) {}
+        Slot(Exp x) : e(x) {}
+        Slot(Jmp x) : j(x) {}
+        Slot(Label x) : l(x) {}
+        Slot(Push x) : push(x) {}
+        Slot(Pop x) : pop(x) {}
+    };
+
+    std::vector<IRTag>   kind;
+    std::vector<Slot>    slot;
+    // Every expression list one after the other, each found by where
+    // it starts and how long it is. The lists being built, which nest
+    // like the calls they are for, wait on pending.
+    std::vector<int>                    _explist_pool;
+    std::vector<std::pair<int, size_t>> _explist;
+    std::vector<int>                    _pending;
 
-    // Exp types
-    std::vector<Const> _const;
-    std::vector<Reg>   _reg;
-    std::vector<Temp>  _temp;
     std::vector<Binop> _binop;
-    std::vector<Mem>   _mem;
     std::vector<Call>  _call;
     std::vector<Cmp>   _cmp;
-
-    // Stm types
     std::vector<Move>  _move;
-    std::vector<Exp>   _exp;
-    std::vector<Jmp>   _jmp;
-    std::vector<Label> _label;
     std::vector<Cjmp>  _cjmp;
-    std::vector<Push>  _push;
-    std::vector<Pop>   _pop;
 
     int base_register;
 
     void spill();
     void mark_sp();
+    int  add(IRTag, Slot);
+    // Moves what is pending from there on into a new list
+    int  keep_explist(size_t from);
+
+    template <typename T, typename F>
+    static decltype(auto) dispatch(T& tree, int ref, F&& f);
 
   public:
     Tree();
@@ -220,81 +311,397 @@ class Tree
     Push const&  get_push(int ref) const;
     Pop const&   get_pop(int ref) const;
 
+    // Calls f with the node at ref, of whatever type its tag says, so
+    // the tag is read once; f usually is a Util::type_switch
+    template <typename F> decltype(auto) visit(int ref, F&& f);
+    template <typename F> decltype(auto) visit(int ref, F&& f) const;
+
     // generic functinality
     IRTag   get_type(int ref) const;
     size_t  size() const;
     Explist get_explist(int) const;
-    int     keep_explist(Explist&&);
     int     new_temp();
 
     label_handle new_label();
     int          place_label(label_handle&&);
 
+    // Puts every node of part after the ones here, and moves its
+    // temps, labels and explists past these too. Children keep ids
+    // smaller than their parents', so Catamorphism still works.
+    void append(Tree const& part);
+
     void simplify();
     void fix_registers(int);
     int  get_register(int);
 
-    void dump(std::ostream&) const;
+    // Works out the text of the nodes on this many threads
+    void dump(std::ostream&, unsigned threads = 1) const;
     void emit(int);
 
-    std::vector<int>                             stm_seq;
-    std::map<std::string, fragment>              methods;
-    std::map<std::string, std::set<std::string>> aliases;
+    // Bytes the nodes take, leaving out spare capacity
+    size_t bytes() const;
+
+    std::vector<int> stm_seq;
+    fragment_table   methods;
+    // The labels that stand for the same method, in spelling order
+    std::map<Symbol, std::set<Symbol, Symbol::by_name>> aliases;
 };
 
 std::ostream& operator<<(std::ostream& out, Tree const&);
 
+// The getters check the tag of the node only in debug builds. In a
+// release build asking for the wrong type is a bug, like an index
+// out of range, and costs nothing to the code that gets it right.
+inline void check_id(IRTag found, IRTag expected)
+{
+#ifndef NDEBUG
+    if (found != expected)
+        throw BadAccess{static_cast<int>(found),
+                        static_cast<int>(expected)};
+#else
+    (void)found;
+    (void)expected;
+#endif
+}
+
+inline IRTag Tree::get_type(int ref) const { return kind[ref]; }
+
+#define IR_FIELD(name, field, ID, ret)                               \
+    inline ret& Tree::get##name(int ref)                             \
+    {                                                                \
+        check_id(kind[ref], ID);                                     \
+        return slot[ref].field;                                      \
+    }                                                                \
+    inline ret const& Tree::get##name(int ref) const                 \
+    {                                                                \
+        check_id(kind[ref], ID);                                     \
+        return slot[ref].field;                                      \
+    }
+
+#define IR_GETTER(name, ID, ret)                                     \
+    inline ret& Tree::get##name(int ref)                             \
+    {                                                                \
+        check_id(kind[ref], ID);                                     \
+        return name[slot[ref].index.pos];                            \
+    }                                                                \
+    inline ret const& Tree::get##name(int ref) const                 \
+    {                                                                \
+        check_id(kind[ref], ID);                                     \
+        return name[slot[ref].index.pos];                            \
+    }
+
+IR_FIELD(_const, c, IRTag::CONST, Const)
+IR_FIELD(_reg, r, IRTag::REG, Reg)
+IR_FIELD(_temp, t, IRTag::TEMP, Temp)
+IR_GETTER(_binop, IRTag::BINOP, Binop)
+IR_FIELD(_mem, m, IRTag::MEM, Mem)
+IR_GETTER(_call, IRTag::CALL, Call)
+IR_GETTER(_move, IRTag::MOVE, Move)
+IR_FIELD(_exp, e, IRTag::EXP, Exp)
+IR_FIELD(_jmp, j, IRTag::JMP, Jmp)
+IR_FIELD(_label, l, IRTag::LABEL, Label)
+IR_GETTER(_cmp, IRTag::CMP, Cmp)
+IR_GETTER(_cjmp, IRTag::CJMP, Cjmp)
+IR_FIELD(_push, push, IRTag::PUSH, Push)
+IR_FIELD(_pop, pop, IRTag::POP, Pop)
+
+#undef IR_GETTER
+#undef IR_FIELD
+
+template <typename T, typename F>
+decltype(auto) Tree::dispatch(T& tree, int ref, F&& f)
+{
+    auto& node = tree.slot[ref];
+    switch (tree.kind[ref]) {
+    case IRTag::CONST:
+        return f(node.c);
+    case IRTag::REG:
+        return f(node.r);
+    case IRTag::TEMP:
+        return f(node.t);
+    case IRTag::BINOP:
+        return f(tree._binop[node.index.pos]);
+    case IRTag::MEM:
+        return f(node.m);
+    case IRTag::CALL:
+        return f(tree._call[node.index.pos]);
+    case IRTag::CMP:
+        return f(tree._cmp[node.index.pos]);
+    case IRTag::MOVE:
+        return f(tree._move[node.index.pos]);
+    case IRTag::EXP:
+        return f(node.e);
+    case IRTag::JMP:
+        return f(node.j);
+    case IRTag::LABEL:
+        return f(node.l);
+    case IRTag::CJMP:
+        return f(tree._cjmp[node.index.pos]);
+    case IRTag::PUSH:
+        return f(node.push);
+    case IRTag::POP:
+        return f(node.pop);
+    }
+    __builtin_unreachable();
+}
+
+template <typename F> decltype(auto) Tree::visit(int ref, F&& f)
+{
+    return dispatch(*this, ref, std::forward<F>(f));
+}
+
+template <typename F>
+decltype(auto) Tree::visit(int ref, F&& f) const
+{
+    return dispatch(*this, ref, std::forward<F>(f));
+}
+
+// The nodes a node refers to, which were all made before it
+template <typename P>
+void children(Tree const& tree, int ref, P&& push)
+{
+    auto two = [&](int lhs, int rhs) { push(lhs), push(rhs); };
+    tree.visit(ref, Util::type_switch{
+                        [&](Binop const& b) { two(b.lhs, b.rhs); },
+                        [&](Cmp const& c) { two(c.lhs, c.rhs); },
+                        [&](Move const& m) { two(m.dst, m.src); },
+                        [&](Cjmp const& c) { two(c.temp, c.target); },
+                        [&](Mem const& m) { push(m.exp); },
+                        [&](Exp const& e) { push(e.exp); },
+                        [&](Jmp const& j) { push(j.target); },
+                        [&](Push const& p) { push(p.ref); },
+                        [&](Pop const& p) { push(p.ref); },
+                        [](auto const&) {}});
+}
+
+// Asks for a node to be worked out only once somebody needs it
+struct on_demand {
+};
+
+// Asks for results that can be brought up to date as the tree changes
+struct incremental {
+};
+
+// Asks for every node to be worked out up front, on this many
+// threads; zero means one per core. f is then called from several
+// threads at once.
+struct in_parallel {
+    unsigned threads;
+};
+
+// Node ids grouped by height, leaves first: level k runs from
+// nodes[first[k]] up to nodes[first[k + 1]], in id order. The nodes
+// of a level do not use each other. A node that uses a newer one, as
+// spill leaves behind, is put below it, since going by ids reads it
+// before it is worked out.
+struct levels {
+    std::vector<int> first;
+    std::vector<int> nodes;
+};
+levels by_height(Tree const&);
+
+// Applies f to the nodes of a tree, children before their parents,
+// keeping what it returns in a dense array indexed by node id; f
+// gets the results of the children through fmap, a plain function
+// object the compiler can inline. By default every node is worked
+// out up front, in id order. With on_demand, a node is worked out
+// the first time it, or a node above it, is asked for, so the cost
+// is that of the nodes actually used; the tree may grow meanwhile.
+//
+// An incremental one is worked out up front as well, and remembers
+// who uses each node. After the tree grows, update() works out only
+// the new nodes. A node rewritten in place is handed to invalidate,
+// and update() then redoes it and every node above it, and nothing
+// else. The nodes above are the ones that had it as an IR child when
+// they were last worked out; what f reaches some other way is not
+// followed.
 template <template <typename C> typename F, typename R>
 struct Catamorphism {
-    using rec_t = std::function<R(int)>;
-    Tree const&    tree;
-    std::vector<R> x;
-    F<rec_t>       f;
+    struct rec_t {
+        Catamorphism* self;
+        R operator()(int ref) const { return (*self)(ref); }
+    };
+
+    Tree const&       tree;
+    std::vector<R>    x;
+    std::vector<bool> done;
+    bool              lazy;
+    bool              track;
+    F<rec_t>          f;
 
     template <typename... Args>
     Catamorphism(IR::Tree const& _t, Args... args)
-        : tree(_t), x(tree.size()),
-          f([&](int i) { return x[i]; }, args...)
+        : tree(_t), x(tree.size()), lazy(false), track(false),
+          f(rec_t{this}, args...)
     {
         for (size_t i = 0; i < tree.size(); i++) x[i] = calculate(i);
     }
 
-    R operator()(int ref) { return x[ref]; }
+    // Level by level, which gives what the plain sweep gives, as
+    // long as f only asks for the children of a node: any other node
+    // may be on a level that is not done yet. The workers fill x at
+    // once, so R must not be bool, which vector packs into bits.
+    template <typename... Args>
+    Catamorphism(in_parallel how, IR::Tree const& _t, Args... args)
+        : tree(_t), x(tree.size()), lazy(false), track(false),
+          f(rec_t{this}, args...)
+    {
+        static_assert(!std::is_same_v<R, bool>,
+                      "a vector<bool> cannot be filled concurrently");
+        ThreadPool pool(how.threads);
+        if (pool.size() == 1) {
+            for (size_t i = 0; i < tree.size(); i++)
+                x[i] = calculate(i);
+            return;
+        }
+
+        size_t const grain = 256;
+        auto const   level = by_height(tree);
+        for (size_t k = 0; k + 1 < level.first.size(); k++) {
+            size_t const lo = level.first[k], hi = level.first[k + 1];
+            pool.run((hi - lo + grain - 1) / grain, [&](size_t c) {
+                size_t const end = std::min(hi, lo + (c + 1) * grain);
+                for (size_t i = lo + c * grain; i < end; i++)
+                    x[level.nodes[i]] = calculate(level.nodes[i]);
+            });
+        }
+    }
+
+    template <typename... Args>
+    Catamorphism(on_demand, IR::Tree const& _t, Args... args)
+        : tree(_t), lazy(true), track(false), f(rec_t{this}, args...)
+    {
+    }
+
+    template <typename... Args>
+    Catamorphism(incremental, IR::Tree const& _t, Args... args)
+        : tree(_t), lazy(true), track(true), f(rec_t{this}, args...)
+    {
+        update();
+    }
+
+    Catamorphism(Catamorphism const&) = delete;
+
+    R operator()(int ref)
+    {
+        if (lazy) evaluate(ref);
+        return x[ref];
+    }
+
+    // ref, which was worked out before, now holds another node
+    void invalidate(int ref)
+    {
+        assert(track);
+        if (static_cast<size_t>(ref) >= done.size() || !done[ref])
+            return;
+        done[ref] = false;
+        stale.push_back(ref);
+        for (size_t k = stale.size() - 1; k < stale.size(); k++)
+            for (int e = first_user[stale[k]]; e != -1;
+                 e = edges[e].next)
+                if (done[edges[e].user]) {
+                    done[edges[e].user] = false;
+                    stale.push_back(edges[e].user);
+                }
+    }
+
+    // Works out the nodes added since the last update and whatever
+    // was invalidated meanwhile
+    void update()
+    {
+        assert(track);
+        for (int ref : stale) evaluate(ref);
+        stale.clear();
+        for (size_t i = synced; i < tree.size(); i++) evaluate(i);
+        synced = tree.size();
+    }
 
   private:
-    R calculate(int ref)
-    {
-        switch (static_cast<IRTag>(tree.get_type(ref))) {
-        case IRTag::CONST:
-            return f(tree.get_const(ref));
-        case IRTag::REG:
-            return f(tree.get_reg(ref));
-        case IRTag::TEMP:
-            return f(tree.get_temp(ref));
-        case IRTag::BINOP:
-            return f(tree.get_binop(ref));
-        case IRTag::MEM:
-            return f(tree.get_mem(ref));
-        case IRTag::CALL:
-            return f(tree.get_call(ref));
-        case IRTag::MOVE:
-            return f(tree.get_move(ref));
-        case IRTag::EXP:
-            return f(tree.get_exp(ref));
-        case IRTag::JMP:
-            return f(tree.get_jmp(ref));
-        case IRTag::LABEL:
-            return f(tree.get_label(ref));
-        case IRTag::CMP:
-            return f(tree.get_cmp(ref));
-        case IRTag::CJMP:
-            return f(tree.get_cjmp(ref));
-        case IRTag::PUSH:
-            return f(tree.get_push(ref));
-        case IRTag::POP:
-            return f(tree.get_pop(ref));
+    // Who uses each node, as linked lists in one array. An edge is
+    // on the list of its child, which first_user starts, and on the
+    // list of the edges of its user, which first_use starts, so that
+    // a node redone drops the edges to what were its children. The
+    // edges dropped are handed out again, so there are only ever as
+    // many as the tree has.
+    struct edge {
+        int user, child;
+        int prev, next;
+        int sibling;
+    };
+    std::vector<int>  first_user;
+    std::vector<int>  first_use;
+    std::vector<edge> edges;
+    int               free_edge = -1;
+    std::vector<int>  stale;
+    size_t            synced = 0;
+
+    R calculate(int ref) { return tree.visit(ref, f); }
+
+    void link(int user, int child)
+    {
+        int e = free_edge;
+        if (e == -1) {
+            e = edges.size();
+            edges.emplace_back();
+        } else {
+            free_edge = edges[e].sibling;
+        }
+        int& head = first_user[child];
+        edges[e]  = {user, child, -1, head, first_use[user]};
+        if (head != -1) edges[head].prev = e;
+        head            = e;
+        first_use[user] = e;
+    }
+
+    void unlink(int user)
+    {
+        for (int e = first_use[user], next; e != -1; e = next) {
+            auto& d = edges[e];
+            if (d.prev != -1)
+                edges[d.prev].next = d.next;
+            else
+                first_user[d.child] = d.next;
+            if (d.next != -1) edges[d.next].prev = d.prev;
+            next      = d.sibling;
+            d.sibling = free_edge;
+            free_edge = e;
+        }
+        first_use[user] = -1;
+    }
+
+    // Post-order from ref over whatever is not done yet. f may still
+    // ask for a node that is not a child, which then recurses; that
+    // holds for the lazy modes only, not for the parallel sweep.
+    void evaluate(int ref)
+    {
+        if (done.size() < tree.size()) {
+            x.resize(tree.size());
+            done.resize(tree.size());
+            if (track) {
+                first_user.resize(tree.size(), -1);
+                first_use.resize(tree.size(), -1);
+            }
+        }
+        if (done[ref]) return;
+
+        std::vector<std::pair<int, bool>> stack{{ref, false}};
+        while (!stack.empty()) {
+            auto [top, expanded] = stack.back();
+            if (done[top]) {
+                stack.pop_back();
+            } else if (expanded) {
+                stack.pop_back();
+                x[top]    = calculate(top);
+                done[top] = true;
+            } else {
+                stack.back().second = true;
+                if (track) unlink(top);
+                children(tree, top, [&](int c) {
+                    if (track) link(top, c);
+                    if (!done[c]) stack.push_back({c, false});
+                });
+            }
         }
-        __builtin_unreachable();
     }
 };
 
@@ -367,7 +774,7 @@ template <typename C> struct ShallowFormat {
     }
     std::string operator()(Call const& c)
     {
-        return std::string("CALL") + c.fn + std::string(" ") +
+        return std::string("CALL") + c.fn.str() + std::string(" ") +
                std::to_string(c.explist);
     }
     std::string operator()(Cmp const& c)
@@ -441,8 +848,9 @@ template <typename C> struct DeepFormat {
     }
     std::string operator()(Call const& c)
     {
-        return std::string("CALL{") + c.fn + std::string(", ") +
-               std::to_string(c.explist) + std::string("}");
+        return std::string("CALL{") + c.fn.str() +
+               std::string(", ") + std::to_string(c.explist) +
+               std::string("}");
     }
     std::string operator()(Cmp const& c)
     {
@@ -14,12 +14,27 @@ IRBuilder& IRBuilder::operator<<(int in)
     return *this;
 }
 
-IRBuilder& IRBuilder::operator<<(std::string _s)
+IRBuilder& IRBuilder::operator<<(Symbol _s)
 {
     s = _s;
     return *this;
 }
 
+ExplistBuilder::ExplistBuilder(IR::Tree& tree)
+    : base(tree), from(tree._pending.size())
+{
+}
+
+ExplistBuilder::~ExplistBuilder() { base._pending.resize(from); }
+
+ExplistBuilder& ExplistBuilder::operator<<(int ref)
+{
+    base._pending.push_back(ref);
+    return *this;
+}
+
+int ExplistBuilder::build() { return base.keep_explist(from); }
+
 int store_in_temp(IR::Tree& t, int exp_ref)
 {
     auto tref = t.new_temp();
@@ -33,80 +48,74 @@ int store_in_temp(IR::Tree& t, int exp_ref)
 
 int IRBuilder::build()
 {
-    if (static_cast<IR::IRTag>(kind) == IR::IRTag::LABEL) return -1;
-    base.kind.push_back(kind);
-    ref = base.pos.size();
-    switch (static_cast<IR::IRTag>(kind)) {
-    case IR::IRTag::CONST:
-        base.pos.push_back(base._const.size());
-        base._const.push_back(IR::Const{data[0]});
+    using IR::IRTag;
+    auto const tag = static_cast<IRTag>(kind);
+    auto const pos = [](auto const& v) {
+        return IR::Tree::Index{static_cast<int>(v.size())};
+    };
+    switch (tag) {
+    case IRTag::CONST:
+        ref = base.add(tag, IR::Const{data[0]});
         break;
-    case IR::IRTag::REG:
-        base.pos.push_back(base._reg.size());
-        base._reg.push_back(IR::Reg{data[0]});
+    case IRTag::REG:
+        ref = base.add(tag, IR::Reg{data[0]});
         break;
-    case IR::IRTag::TEMP:
-        base.pos.push_back(base._temp.size());
-        base._temp.push_back(IR::Temp{base.tmp++});
+    case IRTag::TEMP:
+        ref = base.add(tag, IR::Temp{base.tmp++});
         break;
-    case IR::IRTag::BINOP:
-        base.pos.push_back(base._binop.size());
+    case IRTag::BINOP:
+        ref = base.add(tag, pos(base._binop));
         base._binop.push_back(IR::Binop{data[0], data[1], data[2]});
         break;
-    case IR::IRTag::MEM:
-        base.pos.push_back(base._mem.size());
-        base._mem.push_back(IR::Mem{data[0]});
+    case IRTag::MEM:
+        ref = base.add(tag, IR::Mem{data[0]});
         break;
-    case IR::IRTag::CALL:
-        base.pos.push_back(base._call.size());
+    case IRTag::CALL:
+        ref = base.add(tag, pos(base._call));
         base._call.push_back(IR::Call{s, data[0]});
         break;
-    case IR::IRTag::CMP:
-        base.pos.push_back(base._cmp.size());
+    case IRTag::CMP:
+        ref = base.add(tag, pos(base._cmp));
         base._cmp.push_back(IR::Cmp{data[0], data[1]});
         break;
-    case IR::IRTag::MOVE:
+    case IRTag::MOVE:
+        ref = base.add(tag, pos(base._move));
         base.stm_seq.push_back(ref);
-        base.pos.push_back(base._move.size());
-        data[0] = [&](IR::IRTag tag) {
-            if (tag == IR::IRTag::TEMP || tag == IR::IRTag::MEM ||
-                tag == IR::IRTag::REG)
+        data[0] = [&](IRTag dst) {
+            if (dst == IRTag::TEMP || dst == IRTag::MEM ||
+                dst == IRTag::REG)
                 return data[0];
             else {
                 IRBuilder mem(base);
-                mem << IR::IRTag::MEM << data[0];
+                mem << IRTag::MEM << data[0];
                 return mem.build();
             }
         }(base.get_type(data[0]));
         base._move.push_back(IR::Move{data[0], data[1]});
         break;
-    case IR::IRTag::EXP:
+    case IRTag::EXP:
+        ref = base.add(tag, IR::Exp{data[0]});
         base.stm_seq.push_back(ref);
-        base.pos.push_back(base._exp.size());
-        base._exp.push_back(IR::Exp{data[0]});
         break;
-    case IR::IRTag::JMP:
+    case IRTag::JMP:
+        ref = base.add(tag, IR::Jmp{data[0]});
         base.stm_seq.push_back(ref);
-        base.pos.push_back(base._jmp.size());
-        base._jmp.push_back(IR::Jmp{data[0]});
         break;
-    case IR::IRTag::CJMP:
+    case IRTag::CJMP:
+        ref = base.add(tag, pos(base._cjmp));
         base.stm_seq.push_back(ref);
-        base.pos.push_back(base._cjmp.size());
         base._cjmp.push_back(IR::Cjmp{data[0], data[1]});
         break;
-    case IR::IRTag::PUSH:
+    case IRTag::PUSH:
+        ref = base.add(tag, IR::Push{data[0]});
         base.stm_seq.push_back(ref);
-        base.pos.push_back(base._push.size());
-        base._push.push_back(IR::Push{data[0]});
         break;
-    case IR::IRTag::POP:
+    case IRTag::POP:
+        ref = base.add(tag, IR::Pop{data[0]});
         base.stm_seq.push_back(ref);
-        base.pos.push_back(base._pop.size());
-        base._pop.push_back(IR::Pop{data[0]});
-        break;
-    case IR::IRTag::LABEL:
         break;
+    case IRTag::LABEL:
+        return -1;
     }
     return ref;
 }
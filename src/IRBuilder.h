@@ -5,21 +5,38 @@
 
 class IRBuilder
 {
-    IR::Tree&   base;
-    int         ref;
-    int         kind;
-    int         data[5];
-    size_t      ds;
-    std::string s;
+    IR::Tree& base;
+    int       ref;
+    int       kind;
+    int       data[5];
+    size_t    ds;
+    Symbol    s;
 
   public:
     IRBuilder(IR::Tree& tree);
     IRBuilder& operator<<(IR::IRTag);
     IRBuilder& operator<<(int);
-    IRBuilder& operator<<(std::string);
+    IRBuilder& operator<<(Symbol);
     int        build();
 };
 
+// Collects the ids of one expression list. The arguments of a call
+// are translated while its list is collected, and may be calls too,
+// so builders nest: each one only sees the tree's pending ids from
+// where it started, and takes them back off when it is done.
+class ExplistBuilder
+{
+    IR::Tree& base;
+    size_t    from;
+
+  public:
+    ExplistBuilder(IR::Tree& tree);
+    ExplistBuilder(ExplistBuilder const&) = delete;
+    ~ExplistBuilder();
+    ExplistBuilder& operator<<(int);
+    int             build();
+};
+
 int store_in_temp(IR::Tree&, int);
 
 #endif
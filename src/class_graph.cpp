@@ -1,4 +1,5 @@
 #include "class_graph.h"
+#include <algorithm>
 
 namespace helper
 {
@@ -9,31 +10,100 @@ class_graph::class_graph(AST::ProgramRule const& prog) : cnt(0)
         auto nc = class_graph::name_collector{*this};
         nc(prog);
     }
-    n = names.size();
-    G.resize(n);
-    seen.resize(n);
-    finished.resize(n);
-    ans.reserve(n);
+    n = classes.size();
     {
         auto ec = class_graph::edge_collector{*this};
         ec(prog);
     }
-    for (int i = 0; i < n; i++)
-        if (!seen[i]) dfs(i);
-    std::reverse(begin(ans), end(ans));
+    compress();
+    tarjan();
+    levels();
 }
 
-void class_graph::dfs(int i)
+// Counting sort of the edges by source, which keeps the successors
+// of each class in the order the edges were found
+void class_graph::compress()
 {
-    seen[i] = true;
-    for (auto j : G[i]) {
-        if (seen[j] && !finished[j])
-            throw helper::cyclic_classes{};
-        else if (!seen[j])
-            dfs(j);
+    first.assign(n + 1, 0);
+    for (auto const& [from, to] : edges) first[from + 1]++;
+    for (int i = 0; i < n; i++) first[i + 1] += first[i];
+    adj.resize(edges.size());
+    std::vector<int> fill(begin(first), end(first) - 1);
+    for (auto const& [from, to] : edges) adj[fill[from]++] = to;
+    edges.clear();
+}
+
+// Components are completed dependencies first. ans gets them in
+// reverse and is flipped at the end, which, when there is no cycle,
+// is the very order a recursive depth-first search would give.
+void class_graph::tarjan()
+{
+    int const                        none = -1;
+    std::vector<int>                 index(n, none), low(n);
+    std::vector<int>                 component;
+    std::vector<bool>                on_stack(n);
+    std::vector<std::pair<int, int>> frames;
+    std::vector<std::vector<Symbol>> cycles;
+    int                              next = 0;
+
+    ans.reserve(n);
+    for (int root = 0; root < n; root++) {
+        if (index[root] != none) continue;
+        frames.push_back({root, first[root]});
+        while (!frames.empty()) {
+            auto& [i, edge] = frames.back();
+            if (edge == first[i]) {
+                index[i] = low[i] = next++;
+                component.push_back(i);
+                on_stack[i] = true;
+            }
+            if (edge < first[i + 1]) {
+                int const j = adj[edge++];
+                if (index[j] == none)
+                    frames.push_back({j, first[j]});
+                else if (on_stack[j])
+                    low[i] = std::min(low[i], index[j]);
+                continue;
+            }
+            int const done = i;
+            frames.pop_back();
+            if (!frames.empty()) {
+                int const parent = frames.back().first;
+                low[parent]      = std::min(low[parent], low[done]);
+            }
+            if (low[done] != index[done]) continue;
+
+            // The component is what is left above done on the stack
+            auto const top =
+                std::find(component.rbegin(), component.rend(), done)
+                    .base() -
+                1;
+            bool loop = end(component) - top > 1;
+            for (int k = first[done]; k < first[done + 1]; k++)
+                loop = loop || adj[k] == done;
+            if (loop) {
+                std::vector<int> members(top, end(component));
+                std::sort(begin(members), end(members));
+                auto& cycle = cycles.emplace_back();
+                for (int k : members) cycle.push_back(classes[k]);
+            }
+            for (auto k = top; k != end(component); ++k) {
+                on_stack[*k] = false;
+                ans.push_back(*k);
+            }
+            component.erase(top, end(component));
+        }
     }
-    finished[i] = true;
-    ans.push_back(i);
+    if (!cycles.empty()) throw cyclic_classes{std::move(cycles)};
+    std::reverse(begin(ans), end(ans));
+}
+
+void class_graph::levels()
+{
+    level.assign(n, 0);
+    for (int i : ans)
+        for (int k = first[i]; k < first[i + 1]; k++)
+            level[adj[k]] = std::max(level[adj[k]], level[i] + 1);
 }
 
 void class_graph::name_collector::
@@ -55,10 +125,10 @@ void class_graph::edge_collector::init_vars(
     for (auto const& var : vars) {
         auto const& vdr = Grammar::get<AST::VarDeclRule>(var);
         if (Grammar::holds<AST::classType>(vdr.type)) {
-            std::string const& type_name =
+            Symbol const type_name =
                 Grammar::get<AST::classType>(vdr.type).value;
             int const j = cg.names.at(type_name);
-            cg.G[j].push_back(i);
+            cg.edges.push_back({j, i});
         }
     }
 }
@@ -68,7 +138,7 @@ void class_graph::edge_collector::
 {
     int const i = cg.names.at(cls.name);
     int const j = cg.names.at(cls.superclass);
-    cg.G[j].push_back(i);
+    cg.edges.push_back({j, i});
     init_vars(i, cls.variables);
 }
 
@@ -1,22 +1,33 @@
 #include "AST.h"
 #include "grammar.h"
-#include <algorithm>
-#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace helper
 {
 
+// Every group of classes that need each other's layout to work out
+// their own, each listed in the order the classes were declared
 struct cyclic_classes {
+    std::vector<std::vector<Symbol>> cycles;
 };
 
+// Orders the classes so that a class comes after its superclass and
+// after the classes it holds fields of. Classes are numbered in
+// declaration order, with the main class first, and the edges are
+// kept in compressed rows: the successors of i are
+// adj[first[i]] .. adj[first[i + 1]]. A single iterative Tarjan pass
+// finds the order and every cycle at once, with no recursion however
+// long the chains are.
 class class_graph
 {
-    int                           cnt;
-    int                           n;
-    std::vector<std::vector<int>> G;
-    std::vector<bool>             seen;
-    std::vector<bool>             finished;
-    std::map<std::string, int>    names;
+    int                              cnt;
+    int                              n;
+    std::unordered_map<Symbol, int>  names;
+    std::vector<std::pair<int, int>> edges;
+    std::vector<int>                 first;
+    std::vector<int>                 adj;
 
     struct name_collector {
         class_graph& cg;
@@ -25,6 +36,7 @@ class class_graph
         template <typename T> void operator()(T const& cls)
         {
             cg.names[cls.name] = cg.cnt++;
+            cg.classes.push_back(cls.name);
         }
     };
 
@@ -38,10 +50,16 @@ class class_graph
         void operator()(AST::ProgramRule const&);
     };
 
-    void dfs(int);
+    void compress();
+    void tarjan();
+    void levels();
 
   public:
-    std::vector<int> ans;
+    std::vector<Symbol> classes;
+    std::vector<int>    ans;
+    // How long the longest chain of dependencies down to each class
+    // is. Classes on the same level do not depend on one another.
+    std::vector<int> level;
 
     class_graph(AST::ProgramRule const&);
 };
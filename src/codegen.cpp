@@ -3,7 +3,8 @@
 namespace GEN
 {
 codegen::codegen(std::ostream* _out, IR::Tree& _tree)
-    : out(_out), tree(_tree), need(tree), rg(1)
+    : out(_out), tree(_tree), need(IR::on_demand{}, tree),
+      text(IR::on_demand{}, tree), rg(1)
 {
     tree.simplify();
     flatten(9);
@@ -18,129 +19,109 @@ void codegen::output()
 
 void codegen::__flat_rec(int ref)
 {
-    int lhs, rhs;
-
-    switch (tree.get_type(ref)) {
-    case IR::IRTag::TEMP:
-    case IR::IRTag::PUSH:
-    case IR::IRTag::POP:
-    case IR::IRTag::JMP:
-    case IR::IRTag::LABEL:
-        break;
-
-    case IR::IRTag::EXP:
-        __flat_rec(tree.get_exp(ref).exp);
-        break;
-
-    case IR::IRTag::CALL:
-        tree.emit(ref);
-        break;
-
-    case IR::IRTag::CJMP:
-        __flat_rec(tree.get_cjmp(ref).temp);
-        tree.emit([&] {
-            IRBuilder pop(tree);
-            pop << IR::IRTag::POP << tree.get_register(1);
-            return pop.build();
-        }());
-        tree.emit([&] {
-            IRBuilder cjmp(tree);
-            cjmp << IR::IRTag::CJMP << tree.get_register(1)
-                 << tree.get_cjmp(ref).target;
-            return cjmp.build();
-        }());
-        break;
+    tree.visit(
+        ref,
+        Util::type_switch{
+            [&](IR::Exp exp) { __flat_rec(exp.exp); },
+            [&](IR::Call) { tree.emit(ref); },
+            [&](IR::Cjmp cjmp) {
+                __flat_rec(cjmp.temp);
+                tree.emit([&] {
+                    IRBuilder pop(tree);
+                    pop << IR::IRTag::POP << tree.get_register(1);
+                    return pop.build();
+                }());
+                tree.emit([&] {
+                    IRBuilder jmp(tree);
+                    jmp << IR::IRTag::CJMP << tree.get_register(1)
+                        << cjmp.target;
+                    return jmp.build();
+                }());
+            },
+            [&](IR::Reg) { __flat_push(ref); },
+            [&](IR::Const) { __flat_push(ref); },
+            [&](IR::Mem mem) {
+                __flat_rec(mem.exp);
+                tree.emit([&] {
+                    IRBuilder pop(tree);
+                    pop << IR::IRTag::POP << tree.get_register(1);
+                    return pop.build();
+                }());
+                int const src = [&] {
+                    IRBuilder load(tree);
+                    load << IR::IRTag::MEM << tree.get_register(1);
+                    return load.build();
+                }();
+                tree.emit([&] {
+                    IRBuilder move(tree);
+                    move << IR::IRTag::MOVE << tree.get_register(2)
+                         << src;
+                    return move.build();
+                }());
+                __flat_push(tree.get_register(2));
+            },
+            [&](IR::Move move) {
+                __flat_binary(IR::IRTag::MOVE, 0,
+                              tree.get_mem(move.dst).exp, move.src);
+            },
+            [&](IR::Binop binop) {
+                __flat_binary(IR::IRTag::BINOP, binop.op, binop.lhs,
+                              binop.rhs);
+            },
+            [&](IR::Cmp cmp) {
+                __flat_binary(IR::IRTag::CMP, 0, cmp.lhs, cmp.rhs);
+            },
+            [](auto const&) {}});
+}
 
-    case IR::IRTag::REG:
-    case IR::IRTag::CONST:
-        tree.emit([&] {
-            IRBuilder push(tree);
-            push << IR::IRTag::PUSH << ref;
-            return push.build();
-        }());
-        break;
+void codegen::__flat_push(int ref)
+{
+    tree.emit([&] {
+        IRBuilder push(tree);
+        push << IR::IRTag::PUSH << ref;
+        return push.build();
+    }());
+}
 
-    case IR::IRTag::MEM: {
-        __flat_rec(tree.get_mem(ref).exp);
-        tree.emit([&] {
-            IRBuilder pop(tree);
-            pop << IR::IRTag::POP << tree.get_register(1);
-            return pop.build();
-        }());
-        ref = [&] {
+// Both operands end up on the stack, and are popped into the first
+// two registers; a move stores into the address in the first one
+void codegen::__flat_binary(IR::IRTag tag, int op, int lhs, int rhs)
+{
+    __flat_rec(lhs);
+    __flat_rec(rhs);
+    tree.emit([&] {
+        IRBuilder pop(tree);
+        pop << IR::IRTag::POP << tree.get_register(2);
+        return pop.build();
+    }());
+    tree.emit([&] {
+        IRBuilder pop(tree);
+        pop << IR::IRTag::POP << tree.get_register(1);
+        return pop.build();
+    }());
+    lhs = tree.get_register(1);
+    if (tag == IR::IRTag::MOVE) {
+        lhs = [&] {
             IRBuilder mem(tree);
-            mem << IR::IRTag::MEM << tree.get_register(1);
+            mem << IR::IRTag::MEM << lhs;
             return mem.build();
         }();
+    }
+    rhs = tree.get_register(2);
+    if (tag == IR::IRTag::BINOP)
         tree.emit([&] {
-            IRBuilder move(tree);
-            move << IR::IRTag::MOVE << tree.get_register(2) << ref;
-            return move.build();
-        }());
-        tree.emit([&] {
-            IRBuilder push(tree);
-            push << IR::IRTag::PUSH << tree.get_register(2);
-            return push.build();
-        }());
-    } break;
-
-    case IR::IRTag::MOVE:
-    case IR::IRTag::BINOP:
-    case IR::IRTag::CMP: {
-        if (tree.get_type(ref) == IR::IRTag::MOVE)
-            lhs = tree.get_mem(tree.get_move(ref).dst).exp,
-            rhs = tree.get_move(ref).src;
-        else if (tree.get_type(ref) == IR::IRTag::BINOP)
-            lhs = tree.get_binop(ref).lhs,
-            rhs = tree.get_binop(ref).rhs;
-        else
-            lhs = tree.get_cmp(ref).lhs, rhs = tree.get_cmp(ref).rhs;
-
-        __flat_rec(lhs);
-        __flat_rec(rhs);
-        tree.emit([&] {
-            IRBuilder pop(tree);
-            pop << IR::IRTag::POP << tree.get_register(2);
-            return pop.build();
+            IRBuilder binop(tree);
+            binop << IR::IRTag::BINOP << op << lhs << rhs;
+            return binop.build();
         }());
+    else
         tree.emit([&] {
-            IRBuilder pop(tree);
-            pop << IR::IRTag::POP << tree.get_register(1);
-            return pop.build();
+            IRBuilder curr(tree);
+            curr << tag << lhs << rhs;
+            return curr.build();
         }());
-        lhs = tree.get_register(1);
-        if (tree.get_type(ref) == IR::IRTag::MOVE) {
-            lhs = [&] {
-                IRBuilder mem(tree);
-                mem << IR::IRTag::MEM << lhs;
-                return mem.build();
-            }();
-        }
-        rhs = tree.get_register(2);
-
-        if (tree.get_type(ref) == IR::IRTag::BINOP)
-            tree.emit([&] {
-                IRBuilder binop(tree);
-                binop << IR::IRTag::BINOP << tree.get_binop(ref).op
-                      << lhs << rhs;
-                return binop.build();
-            }());
-        else
-            tree.emit([&] {
-                IRBuilder curr(tree);
-                curr << tree.get_type(ref) << lhs << rhs;
-                return curr.build();
-            }());
 
-        if (tree.get_type(ref) != IR::IRTag::MOVE)
-            tree.emit([&] {
-                IRBuilder push(tree);
-                push << IR::IRTag::PUSH << tree.get_register(1);
-                return push.build();
-            }());
-        break;
-    }
-    }
+    if (tag != IR::IRTag::MOVE) __flat_push(tree.get_register(1));
 }
 
 void codegen::__flat(int ref)
@@ -180,12 +161,11 @@ void codegen::generate_fragment(fragment_t mtd)
             Util::write(*out, alias, ":\n");
 
     Util::write(*out, name, ":\n");
-    IR::Catamorphism<x86Output, std::string> F(tree);
     for (int s : frag.stms)
         if (tree.get_type(s) == IR::IRTag::LABEL)
-            Util::write(*out, F(s), ":\t\t;", s);
+            Util::write(*out, text(s), ":\t\t;", s);
         else
-            Util::write(*out, F(s), "\t\t;", s);
+            Util::write(*out, text(s), "\t\t;", s);
     Util::write(*out, "ret");
 }
 
@@ -202,10 +182,10 @@ void codegen::flatten(int k)
 void codegen::__x86_call(int ref)
 {
     auto const& [fn, _es] = tree.get_call(ref);
-    auto es               = tree.get_explist(_es);
+    auto const es         = tree.get_explist(_es);
 
-    std::reverse(begin(es), end(es));
-    for (int e : es) __flat_rec(e);
+    // Flattening adds nodes but no lists, so es stays good
+    for (size_t i = es.size(); i-- > 0;) __flat_rec(es[i]);
     for (int i = 0; i < std::min<int>(6, es.size()); i++)
         tree.emit([&] {
             IRBuilder pop(tree);
@@ -376,7 +356,7 @@ void codegen::prepare_x86_call()
                 __x86_call(s);
         }
 
-        if (name != std::string("main")) {
+        if (name != "main") {
             tree.emit([&] {
                 IRBuilder pop(tree);
                 pop << IR::IRTag::POP << tree.get_register(7);
@@ -39,30 +39,6 @@ template <typename C> struct SethiUllman {
     C fmap;
 };
 
-class codegen
-{
-    using fragment_t =
-        typename std::map<std::string, IR::fragment>::value_type;
-    std::ostream*                      out;
-    IR::Tree&                          tree;
-    IR::Catamorphism<SethiUllman, int> need;
-
-    void __x86_call(int);
-    void __align_x86_call();
-    void __flat_rec(int);
-    void __flat(int);
-    void emit(int);
-
-    int rg;
-
-  public:
-    codegen(std::ostream*, IR::Tree&);
-    void generate_fragment(fragment_t);
-    void flatten(int k);
-    void prepare_x86_call();
-    void output();
-};
-
 // clang-format off
 inline std::string prelude = {"global main" "\n"
                               "extern printf" "\n"
@@ -112,7 +88,7 @@ template <typename C> struct x86Output {
     }
     std::string operator()(IR::Call const& c)
     {
-        return std::string("call ") + c.fn;
+        return std::string("call ") + c.fn.str();
     }
     std::string operator()(IR::Cmp const& c)
     {
@@ -153,6 +129,34 @@ template <typename C> struct x86Output {
     x86Output(C&& __fmap) : fmap(__fmap) {}
     C fmap;
 };
+
+class codegen
+{
+    using fragment_t = IR::fragment_table::value_type;
+    std::ostream*                            out;
+    IR::Tree&                                tree;
+    IR::Catamorphism<SethiUllman, int>       need;
+    // Shared by every fragment, and only worked out for the nodes
+    // their statements reach
+    IR::Catamorphism<x86Output, std::string> text;
+
+    void __x86_call(int);
+    void __align_x86_call();
+    void __flat_rec(int);
+    void __flat_push(int);
+    void __flat_binary(IR::IRTag, int op, int lhs, int rhs);
+    void __flat(int);
+    void emit(int);
+
+    int rg;
+
+  public:
+    codegen(std::ostream*, IR::Tree&);
+    void generate_fragment(fragment_t);
+    void flatten(int k);
+    void prepare_x86_call();
+    void output();
+};
 } // namespace GEN
 
 #endif
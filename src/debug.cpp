@@ -3,6 +3,7 @@
 #include "parser.h"
 #include "translate.h"
 #include "util.h"
+#include <fstream>
 
 int main(int argc, char** argv)
 {
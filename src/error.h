@@ -1,7 +1,9 @@
 #ifndef BCC_ASTERROR
 #define BCC_ASTERROR
 #include "AST.h"
+#include "ASTCatamorphism.h"
 #include "grammar.h"
+#include "logger.h"
 #include "util.h"
 
 template <typename ostream> class OstreamReporter
@@ -18,7 +20,7 @@ template <typename ostream> class OstreamReporter
             size_t i = 0;
             if (err.ctx.size() && err.lines[0] == -1) {
                 Util::write(out,
-                            err.ctx[0] + std::string(":") +
+                            err.ctx[0].str() + ":" +
                                 std::to_string(err.lines.back()));
                 i++;
             }
@@ -48,133 +50,66 @@ template <typename ostream> class OstreamReporter
 
 template <typename ostream> class Reporter
 {
-    ostream&                     out;
-    OstreamReporter<ostream>     logger;
-    std::vector<AST::ErrorData>& E;
-    bool                         ok;
+    ostream&                 out;
+    OstreamReporter<ostream> logger;
+    Diagnostics const&       E;
+    bool                     ok;
 
-  public:
-    Reporter(ostream& __out, std::vector<AST::ErrorData>& err)
-        : out(__out), logger(out), E(err), ok(true)
-    {
-    }
-
-    operator bool() const { return ok; }
+    // Prints the errors of one node; the catamorphism visits the
+    // children of a node before the node itself
+    template <typename C> struct Print {
+        C         fmap;
+        Reporter& rep;
 
-    void operator()(const AST::ProgramRule& prog)
-    {
-        Grammar::visit(*this, prog.main);
-        for (auto& c : prog.classes) Grammar::visit(*this, c);
-        for (auto& err : E[prog.id]) logger(*err);
-        if (E[prog.id].size()) ok = false;
-    }
+        Print(C&& __fmap, Reporter& _rep) : fmap(__fmap), rep(_rep) {}
 
-    void operator()(const AST::MainClassRule& main)
-    {
-        Grammar::visit(*this, main.body);
-        for (auto& err : E[main.id]) {
-            Util::write(out, "At main class");
-            logger(*err);
-        }
-        if (E[main.id].size()) ok = false;
-    }
-
-    void operator()(const AST::ClassDeclNoInheritance& cls)
-    {
-        for (auto& v : cls.variables) Grammar::visit(*this, v);
-        for (auto& m : cls.methods) Grammar::visit(*this, m);
-        for (auto& err : E[cls.id]) {
-            Util::write(out, "At class ", cls.name);
-            logger(*err);
-        }
-        if (E[cls.id].size()) ok = false;
-    }
-
-    void operator()(const AST::ClassDeclInheritance& cls)
-    {
-        for (auto& v : cls.variables) Grammar::visit(*this, v);
-        for (auto& m : cls.methods) Grammar::visit(*this, m);
-        for (auto& err : E[cls.id]) {
-            Util::write(out, "At class", cls.name);
-            logger(*err);
+        template <typename T> bool operator()(const T& node)
+        {
+            return rep.report(node);
         }
-        if (E[cls.id].size()) ok = false;
-    }
-
-    void operator()(const AST::VarDeclRule& vd)
-    {
-        Grammar::visit(*this, vd.type);
-        for (auto& err : E[vd.id]) logger(*err);
-        if (E[vd.id].size()) ok = false;
-    }
+    };
 
-    void operator()(const AST::MethodDeclRule& mtd)
+    // Where an error is, for the nodes whose errors say so
+    template <typename T> static std::string at(const T&)
     {
-        Grammar::visit(*this, mtd.type);
-        Grammar::visit(*this, mtd.arguments);
-        for (auto& v : mtd.variables) Grammar::visit(*this, v);
-        for (auto& s : mtd.body) Grammar::visit(*this, s);
-        Grammar::visit(*this, mtd.return_exp);
-        for (auto& err : E[mtd.id]) logger(*err);
-        if (E[mtd.id].size()) ok = false;
+        return {};
     }
-
-    void operator()(const AST::blockStm& blk)
+    static std::string at(const AST::MainClassRule&)
     {
-        for (auto& s : blk.statements) Grammar::visit(*this, s);
-        for (auto& err : E[blk.id]) logger(*err);
-        if (E[blk.id].size()) ok = false;
+        return "At main class";
     }
-
-    void operator()(const AST::ifStm& ifs)
+    static std::string at(const AST::ClassDeclNoInheritance& cls)
     {
-        Grammar::visit(*this, ifs.condition);
-        Grammar::visit(*this, ifs.if_clause);
-        Grammar::visit(*this, ifs.else_clause);
-        for (auto& err : E[ifs.id]) logger(*err);
-        if (E[ifs.id].size()) ok = false;
+        return "At class  " + cls.name.str();
     }
-
-    void operator()(const AST::whileStm& stm)
+    static std::string at(const AST::ClassDeclInheritance& cls)
     {
-        Grammar::visit(*this, stm.condition);
-        Grammar::visit(*this, stm.body);
-        for (auto& err : E[stm.id]) logger(*err);
-        if (E[stm.id].size()) ok = false;
+        return "At class " + cls.name.str();
     }
 
-    void operator()(const AST::printStm& stm)
+    template <typename T> bool report(const T& node)
     {
-        Grammar::visit(*this, stm.exp);
-        for (auto& err : E[stm.id]) logger(*err);
-        if (E[stm.id].size()) ok = false;
-    }
-
-    void operator()(const AST::assignStm& stm)
-    {
-        Grammar::visit(*this, stm.value);
-        for (auto& err : E[stm.id]) logger(*err);
-        if (E[stm.id].size()) ok = false;
+        for (auto& err : E[node.id]) {
+            if (auto where = at(node); !where.empty())
+                Util::write(out, where);
+            logger(*err);
+        }
+        if (E[node.id].size()) ok = false;
+        return E[node.id].empty();
     }
 
-    void operator()(const AST::indexAssignStm& stm)
+  public:
+    Reporter(ostream& __out, Diagnostics const& err)
+        : out(__out), logger(out), E(err), ok(true)
     {
-        Grammar::visit(*this, stm.index);
-        Grammar::visit(*this, stm.value);
-        for (auto& err : E[stm.id]) logger(*err);
-        if (E[stm.id].size()) ok = false;
     }
 
-    void operator()(const AST::FormalListRule& lst)
-    {
-        for (auto& err : E[lst.id]) logger(*err);
-        if (E[lst.id].size()) ok = false;
-    }
+    operator bool() const { return ok; }
 
-    template <typename T> void operator()(const T& leaf)
+    // Reports every error below node, children first
+    template <typename T> void operator()(const T& node)
     {
-        for (auto& err : E[leaf.id]) logger(*err);
-        if (E[leaf.id].size()) ok = false;
+        AST::Catamorphism<Print, bool>(node, *this);
     }
 };
 
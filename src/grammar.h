@@ -1,22 +1,131 @@
 #ifndef BCC_GRAMMAR
 #define BCC_GRAMMAR
 
-#include <memory>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
 #include <utility>
 #include <variant>
+#include <vector>
 
 namespace Grammar
 {
+// The nodes one parser makes. Every node of one alternative, say
+// every sumExp, sits next to the others of its kind, in chunks that
+// never move; a kind's chunks double in size as it grows. An arena
+// belongs to a single parser, which makes its nodes from one thread,
+// so it takes no lock. Nodes are never freed one by one: the arena
+// destroys all of them at once, chunk by chunk, in plain loops. The
+// handles in a node own nothing, so that does not recurse however
+// deep the tree is.
+class Arena
+{
+    static constexpr uint32_t first = 256;
+
+    struct Chunk {
+        unsigned char* bytes;
+        uint32_t       used;
+        void (*destroy)(unsigned char*, uint32_t);
+    };
+
+    std::vector<Chunk> chunks;
+    // By kind, the chunk being filled and how many nodes it holds
+    std::vector<std::pair<int, uint32_t>> filling;
+
+    static size_t next_kind()
+    {
+        static std::atomic<size_t> kinds{0};
+        return kinds++;
+    }
+
+    template <typename T> static size_t kind()
+    {
+        static size_t const k = next_kind();
+        return k;
+    }
+
+    template <typename T>
+    static void destroy(unsigned char* bytes, uint32_t used)
+    {
+        auto* nodes = std::launder(reinterpret_cast<T*>(bytes));
+        for (uint32_t i = 0; i < used; i++) nodes[i].~T();
+        ::operator delete(bytes);
+    }
+
+  public:
+    Arena() = default;
+    Arena(Arena const&) = delete;
+    ~Arena()
+    {
+        for (auto const& c : chunks) c.destroy(c.bytes, c.used);
+    }
+
+    // Where the nodes made on this thread go, see AST::Builder
+    static Arena*& current()
+    {
+        thread_local Arena* arena = nullptr;
+        return arena;
+    }
+
+    template <typename T, typename... Args> T* make(Args&&... args)
+    {
+        static_assert(alignof(T) <= alignof(std::max_align_t));
+        size_t const k = kind<T>();
+        if (filling.size() <= k) filling.resize(k + 1, {-1, 0});
+        auto& [at, size] = filling[k];
+        if (at == -1 || chunks[at].used == size) {
+            size       = at == -1 ? first : 2 * size;
+            void* fresh = ::operator new(size * sizeof(T));
+            chunks.push_back({static_cast<unsigned char*>(fresh), 0,
+                              &destroy<T>});
+            at = chunks.size() - 1;
+        }
+        auto& chunk = chunks[at];
+        T*    node  = new (chunk.bytes + chunk.used * sizeof(T))
+            T(std::forward<Args>(args)...);
+        chunk.used++;
+        return node;
+    }
+};
+
+template <typename T, typename variant> struct alternative;
+template <typename T, typename... Ts>
+struct alternative<T, std::variant<Ts...>> {
+    static constexpr uint8_t value = [] {
+        constexpr bool same[] = {std::is_same_v<T, Ts>...};
+        uint8_t        k      = 0;
+        while (k < sizeof...(Ts) && !same[k]) k++;
+        return k;
+    }();
+    static_assert(value < sizeof...(Ts), "not an alternative");
+};
+
+// A node is the alternative it holds and where the arena of its
+// parser keeps it: a handle, not an owner. Both fit in one word, as
+// user-space addresses leave the top byte clear on the 64-bit
+// targets we build for. The variant only names the alternatives and
+// is never instantiated.
 template <typename variant> struct Nonterminal {
     using variant_t = variant;
 
-    template <typename T>
+    template <typename T,
+              typename = std::enable_if_t<
+                  !std::is_base_of_v<Nonterminal, std::decay_t<T>>>>
     Nonterminal(T&& in)
-        : _self(std::make_unique<variant_t>(std::forward<T>(in)))
+        : bits(tag(alternative<std::decay_t<T>, variant_t>::value,
+                   Arena::current()->template make<std::decay_t<T>>(
+                       std::forward<T>(in))))
     {
     }
+    Nonterminal(Nonterminal&&)            = default;
+    Nonterminal& operator=(Nonterminal&&) = default;
+
     template <class Visitor, class Nonterminal>
-    friend constexpr auto visit(Visitor&& vis, Nonterminal&& nt);
+    friend constexpr decltype(auto) visit(Visitor&& vis,
+                                          Nonterminal&& nt);
     template <typename Alternative, class Nonterminal>
     friend constexpr const Alternative& get(Nonterminal&&);
     template <typename Alternative, class Nonterminal>
@@ -25,31 +134,80 @@ template <typename variant> struct Nonterminal {
     friend constexpr std::size_t index(Nonterminal&&);
 
   protected:
-    std::unique_ptr<variant_t> _self;
+    // Only for Type. A copy is the same node, which never changes
+    // once it is made.
+    Nonterminal(Nonterminal const&) = default;
+
+    static_assert(sizeof(uintptr_t) == 8, "needs 64-bit pointers");
+    static constexpr uintptr_t address = ~uintptr_t(0) >> 8;
+
+    uintptr_t bits;
+
+    static uintptr_t tag(uint8_t kind, void const* node)
+    {
+        auto const at = reinterpret_cast<uintptr_t>(node);
+        assert((at & ~address) == 0);
+        return uintptr_t(kind) << 56 | at;
+    }
+    uint8_t     kind() const { return bits >> 56; }
+    void const* node() const
+    {
+        return reinterpret_cast<void const*>(bits & address);
+    }
 };
 
+namespace __detail
+{
+template <typename R, typename V, typename variant_t, size_t k>
+R call(V& vis, void const* node)
+{
+    using T = std::variant_alternative_t<k, variant_t>;
+    return vis(*static_cast<T const*>(node));
+}
+
+// One entry per alternative, like the table std::visit builds
+template <typename R, typename V, typename variant_t, size_t... k>
+constexpr auto dispatch(std::index_sequence<k...>)
+{
+    return std::array<R (*)(V&, void const*), sizeof...(k)>{
+        &call<R, V, variant_t, k>...};
+}
+} // namespace __detail
+
 template <class Visitor, class Nonterminal>
-constexpr auto visit(Visitor&& vis, Nonterminal&& nt)
+constexpr decltype(auto) visit(Visitor&& vis, Nonterminal&& nt)
 {
-    return std::visit(std::forward<Visitor>(vis), *nt._self);
+    using variant_t = typename std::decay_t<Nonterminal>::variant_t;
+    using first_t   = std::variant_alternative_t<0, variant_t>;
+    using result_t  = decltype(vis(std::declval<first_t const&>()));
+    using visitor_t = std::remove_reference_t<Visitor>;
+    constexpr size_t arity = std::variant_size_v<variant_t>;
+    constexpr auto   table =
+        __detail::dispatch<result_t, visitor_t, variant_t>(
+            std::make_index_sequence<arity>());
+    return table[nt.kind()](vis, nt.node());
 }
 
 template <typename Alternative, class Nonterminal>
 constexpr const Alternative& get(Nonterminal&& nt)
 {
-    return std::get<Alternative>(*nt._self);
+    using variant_t = typename std::decay_t<Nonterminal>::variant_t;
+    if (nt.kind() != alternative<Alternative, variant_t>::value)
+        throw std::bad_variant_access();
+    return *static_cast<Alternative const*>(nt.node());
 }
 
 template <typename Alternative, class Nonterminal>
 constexpr bool holds(Nonterminal&& nt)
 {
-    return std::holds_alternative<Alternative>(*nt._self);
+    using variant_t = typename std::decay_t<Nonterminal>::variant_t;
+    return nt.kind() == alternative<Alternative, variant_t>::value;
 }
 
 template <class Nonterminal>
 constexpr std::size_t index(Nonterminal&& nt)
 {
-    return nt._self->index();
+    return nt.kind();
 }
 
 struct Indexable {
@@ -5,7 +5,7 @@ namespace helper
 memory_layout::common_t
 memory_layout::smooth(std::vector<AST::VarDecl> const& vars)
 {
-    std::vector<AST::FormalDecl> ans;
+    common_t ans;
     for (auto const& var : vars) {
         auto const& vdr = Grammar::get<AST::VarDeclRule>(var);
         ans.push_back({vdr.type, vdr.name});
@@ -16,8 +16,11 @@ memory_layout::smooth(std::vector<AST::VarDecl> const& vars)
 memory_layout::common_t
 memory_layout::smooth(AST::FormalList const& lst)
 {
-    auto flr = Grammar::get<AST::FormalListRule>(lst);
-    return flr.decls;
+    common_t ans;
+    for (auto const& [type, name] :
+         Grammar::get<AST::FormalListRule>(lst).decls)
+        ans.push_back({type, name});
+    return ans;
 }
 
 memory_layout::common_t
@@ -39,54 +42,61 @@ memory_layout::smooth(AST::MainClassRule const&)
 }
 
 memory_layout::memory_layout() : size(0) {}
-memory_layout::memory_layout(meta_data const&               data,
-                             std::map<std::string, kind_t>& kind,
-                             memory_layout::common_t const& vars)
-    : size(0), source([&] {
-          common_t ans;
-          for (auto const& var : vars)
-              ans.push_back({var.type, var.name});
-          return ans;
-      }())
+memory_layout::memory_layout(
+    meta_data const& data, std::unordered_map<Symbol, kind_t>& kind,
+    memory_layout::common_t const& vars)
+    : size(0)
 {
-    for (auto const& [type, name] : source) {
-        kind[name]  = kind_t::var;
-        value[name] = size;
-        size += data.type_size(type);
+    for (auto const& var : vars) {
+        kind[var.name] = kind_t::var;
+        push_back(data, var);
     }
 }
 
-bool memory_layout::has(std::string const& name) const
+void memory_layout::push_back(meta_data const& data, var_t const& var)
+{
+    value.insert({var.name, {size, var.type}});
+    size += data.type_size(var.type);
+    source.push_back(var);
+}
+
+bool memory_layout::has(Symbol name) const
 {
     return value.count(name) != 0;
 }
 
-int memory_layout::operator[](std::string const& name) const
+int memory_layout::operator[](Symbol name) const
 {
-    return value.at(name);
+    return value.at(name).offset;
+}
+
+memory_layout::slot_t const* memory_layout::find(Symbol name) const
+{
+    auto it = value.find(name);
+    return it == value.end() ? nullptr : &it->second;
 }
 
 method_spec::method_spec(meta_data const& d, class_spec const& c,
-                         std::string const& n, memory_layout&& l,
+                         Symbol n, memory_layout&& l,
                          memory_layout::common_t&& _arglist,
-                         AST::Type                 _rt)
+                         AST::TypeRef              _rt)
     : data(d), cls(c), name(n), layout(std::move(l)),
       arglist(std::move(_arglist)), return_type(_rt)
 {
 }
 method_spec::method_spec(meta_data const& d, class_spec const& c,
-                         std::string const& n, memory_layout const& l,
+                         Symbol n, memory_layout const& l,
                          memory_layout::common_t&& _arglist,
-                         AST::Type                 _rt)
+                         AST::TypeRef              _rt)
     : data(d), cls(c), name(n), layout(l),
       arglist(std::move(_arglist)), return_type(_rt)
 {
 }
 
-void class_spec::insert_method(std::string const&        name,
+void class_spec::insert_method(Symbol                    name,
                                memory_layout&&           layout,
                                memory_layout::common_t&& args,
-                               AST::Type                 type)
+                               AST::TypeRef              type)
 {
     if (m_id.count(name)) return;
     methods.push_back(name);
@@ -96,16 +106,6 @@ void class_spec::insert_method(std::string const&        name,
                         std::move(args), type);
 }
 
-void class_spec::insert_method(std::string const& name,
-                               method_spec const& mtd)
-{
-    if (m_id.count(name)) return;
-    methods.push_back(name);
-    kind[name] = kind_t::method_inh;
-    m_id[name] = m_info.size();
-    m_info.push_back(mtd);
-}
-
 void class_spec::init_methods(
     std::vector<AST::MethodDecl> const& mtds)
 {
@@ -121,7 +121,7 @@ void class_spec::init_methods(
 
 class_spec::class_spec(meta_data const&          d,
                        AST::MainClassRule const& cls)
-    : data(d), name(cls.name), base(-1),
+    : data(d), parent(nullptr), name(cls.name), base(-1),
       variable(data, kind, memory_layout::smooth(cls))
 {
     insert_method("main", memory_layout{data, kind, {}}, {},
@@ -130,133 +130,167 @@ class_spec::class_spec(meta_data const&          d,
 
 class_spec::class_spec(meta_data const&                   d,
                        AST::ClassDeclNoInheritance const& cls)
-    : data(d), name(cls.name), base(-1),
+    : data(d), parent(nullptr), name(cls.name), base(-1),
       variable(data, kind, memory_layout::smooth(cls))
 {
-    init_methods(cls.methods);
 }
 
 class_spec::class_spec(meta_data const&                 d,
                        AST::ClassDeclInheritance const& cls)
-    : data(d), name(cls.name), base(data.c_id.at(cls.superclass)),
-      variable([&] {
+    : data(d), parent(&data[cls.superclass]), name(cls.name),
+      base(data.c_id.at(cls.superclass)), variable([&] {
           auto ans = data[cls.superclass].variable;
           for (auto const& var :
                memory_layout::smooth(cls.variables)) {
-              ans.value.insert({var.name, ans.size});
-              ans.size += data.type_size(var.type);
+              kind[var.name] = kind_t::var;
+              ans.push_back(data, var);
           }
           return ans;
       }())
 {
-    init_methods(cls.methods);
-    for (int b = base; b != -1; b = data.c_info[b].base) {
-        auto const& info = data.c_info[b];
-        for (auto const& i : info.m_id)
-            insert_method(i.first, info.m_info[i.second]);
-        kind.insert(begin(info.kind), end(info.kind));
-    }
 }
 
 int class_spec::size() const { return variable.size; }
 
-kind_t class_spec::operator[](std::string const& name) const
+kind_t class_spec::operator[](Symbol name) const
 {
-    if (kind.count(name)) return kind.at(name);
-    if (base != -1) return data.c_info[base][name];
+    for (auto c = this; c; c = c->parent) {
+        auto it = c->kind.find(name);
+        if (it == c->kind.end()) continue;
+        if (c != this && it->second == kind_t::method_def)
+            return kind_t::method_inh;
+        return it->second;
+    }
     return kind_t::notfound;
 }
 
-method_spec& class_spec::method(std::string const& name)
-{
-    return m_info[m_id.at(name)];
+// Arguments hide locals, which hide the fields of the class
+binding class_spec::resolve(Symbol mtd, Symbol name) const
+{
+    auto const& spec = method(mtd);
+    for (size_t i = 0; i < spec.arglist.size(); i++)
+        if (spec.arglist[i].name == name)
+            return {binding::argument, int(i), spec.arglist[i].type};
+    if (auto slot = spec.layout.find(name))
+        return {binding::local, slot->offset, slot->type};
+    if (auto slot = variable.find(name))
+        return {binding::field, slot->offset, slot->type};
+    return {};
 }
 
-method_spec const& class_spec::method(std::string const& name) const
+method_spec const& class_spec::method(Symbol name) const
 {
-    return m_info[m_id.at(name)];
+    for (auto c = this; c; c = c->parent) {
+        auto it = c->m_id.find(name);
+        if (it != c->m_id.end()) return c->m_info[it->second];
+    }
+    throw std::out_of_range("no method " + name.str());
 }
 
-meta_data::meta_data(AST::Program const& prog)
+meta_data::meta_data(AST::Program const& prog, unsigned threads)
 {
-    Grammar::visit(*this, prog);
+    ThreadPool pool(threads);
+    build(Grammar::get<AST::ProgramRule>(prog), pool);
 }
 
 meta_data::meta_data() {}
 
-void meta_data::operator()(AST::ProgramRule const& prog)
+void meta_data::build(AST::ProgramRule const& prog, ThreadPool& pool)
 {
     class_graph top_sort(prog);
-    for (int i : top_sort.ans)
+    auto const& order = top_sort.ans;
+    auto        decl  = [&](int i, auto&& f) {
         if (i == 0)
-            Grammar::visit(*this, prog.main);
+            Grammar::visit(f, prog.main);
         else
-            Grammar::visit(*this, prog.classes[i - 1]);
+            Grammar::visit(f, prog.classes[i - 1]);
+    };
+
+    // Ids are handed out in topological order up front, and so are
+    // the types of the classes, so that neither depends on which
+    // thread gets to a class first
+    c_info.resize(order.size());
+    std::vector<std::vector<int>> levels;
+    for (size_t k = 0; k < order.size(); k++) {
+        Symbol const name = top_sort.classes[order[k]];
+        c_id[name]        = k;
+        static_cast<void>(AST::TypeRef(AST::classType(name)));
+        size_t const l = top_sort.level[order[k]];
+        if (l >= levels.size()) levels.resize(l + 1);
+        levels[l].push_back(order[k]);
+    }
+
+    for (auto const& level : levels)
+        pool.run(level.size(),
+                 [&](size_t k) { decl(level[k], *this); });
+
+    auto methods = Util::type_switch{
+        [&](AST::MainClassRule const&) {},
+        [&](AST::ClassDeclNoInheritance const& cls) {
+            (*this)[cls.name].init_methods(cls.methods);
+        },
+        [&](AST::ClassDeclInheritance const& cls) {
+            (*this)[cls.name].init_methods(cls.methods);
+        }};
+    pool.run(order.size(),
+             [&](size_t k) { decl(order[k], methods); });
 }
 
 void meta_data::operator()(AST::MainClassRule const& cls)
 {
-    c_id[cls.name] = static_cast<int>(c_info.size());
-    c_info.emplace_back(*this, cls);
+    auto& spec = c_info[c_id.at(cls.name)];
+    spec       = std::make_unique<class_spec>(*this, cls);
 }
 
 void meta_data::operator()(AST::ClassDeclNoInheritance const& cls)
 {
-    c_id[cls.name] = static_cast<int>(c_info.size());
-    c_info.emplace_back(*this, cls);
+    auto& spec = c_info[c_id.at(cls.name)];
+    spec       = std::make_unique<class_spec>(*this, cls);
 }
 
 void meta_data::operator()(AST::ClassDeclInheritance const& cls)
 {
-    c_id[cls.name] = static_cast<int>(c_info.size());
-    c_info.emplace_back(*this, cls);
+    auto& spec = c_info[c_id.at(cls.name)];
+    spec       = std::make_unique<class_spec>(*this, cls);
 }
 
-int meta_data::count(std::string const& name) const
+int meta_data::count(Symbol name) const
 {
     return c_id.count(name);
 }
 
-class_spec& meta_data::operator[](std::string const& name)
+class_spec& meta_data::operator[](Symbol name)
 {
-    return c_info.at(c_id.at(name));
+    return *c_info.at(c_id.at(name));
 }
 
-class_spec const& meta_data::operator[](std::string const& name) const
+class_spec const& meta_data::operator[](Symbol name) const
 {
-    return c_info.at(c_id.at(name));
+    return *c_info.at(c_id.at(name));
 }
 
-class_spec& meta_data::operator[](int id) { return c_info.at(id); }
+class_spec& meta_data::operator[](int id) { return *c_info.at(id); }
 
 class_spec const& meta_data::operator[](int id) const
 {
-    return c_info.at(id);
+    return *c_info.at(id);
 }
 
-int meta_data::type_size(std::string const& type) const
+int meta_data::type_size(Symbol type) const
 {
     return (*this)[type].size();
 }
 
-int meta_data::type_size(AST::Type const& type) const
+int meta_data::type_size(AST::TypeRef type) const
 {
-    struct Visitor {
-        meta_data const& data;
-        int operator()(AST::integerArrayType const&) { return 8; }
-        int operator()(AST::booleanType const&) { return 8; }
-        int operator()(AST::integerType const&) { return 8; }
-        int operator()(AST::classType const& ct)
-        {
-            return data.type_size(ct.value);
-        }
-    };
-    return Grammar::visit(Visitor{*this}, type);
+    if (type.kind() == AST::TypeRef::object)
+        return type_size(type.name());
+    return 8;
 }
 
-std::string mangle(std::string cls, std::string mtd)
+Symbol mangle(Symbol cls, Symbol mtd)
 {
-    return std::string("_Z") + cls + std::string("_") + mtd;
+    return Symbol("_Z" + cls.str() + "_" + mtd.str());
 }
 
 } // namespace helper
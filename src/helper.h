@@ -3,8 +3,11 @@
 #include "AST.h"
 #include "class_graph.h"
 #include "parser.h"
-#include <map>
+#include "thread_pool.h"
+#include "type.h"
+#include <memory>
 #include <string>
+#include <unordered_map>
 
 namespace helper
 {
@@ -13,17 +16,39 @@ enum class kind_t { notfound, var, instance, method_def, method_inh };
 class meta_data;
 class class_spec;
 
+// A variable as the layouts see it
+struct var_t {
+    AST::TypeRef type;
+    Symbol       name;
+};
+
+// Where a name is stored, as seen from inside a method: the index of
+// an argument, or the byte offset of a local or a field
+struct binding {
+    enum where_t : uint8_t { notfound, argument, local, field };
+    where_t      where = notfound;
+    int          offset = 0;
+    AST::TypeRef type;
+};
+
 struct memory_layout {
-    using common_t = std::vector<AST::FormalDecl>;
-    std::map<std::string, int> value;
-    int                        size;
-    common_t                   source;
+    using common_t = std::vector<var_t>;
+    struct slot_t {
+        int          offset;
+        AST::TypeRef type;
+    };
+    std::unordered_map<Symbol, slot_t> value;
+    int                                size;
+    common_t                           source;
 
     memory_layout();
-    memory_layout(meta_data const&, std::map<std::string, kind_t>&,
+    memory_layout(meta_data const&,
+                  std::unordered_map<Symbol, kind_t>&,
                   common_t const&);
-    int  operator[](std::string const&) const;
-    bool has(std::string const&) const;
+    int           operator[](Symbol) const;
+    bool          has(Symbol) const;
+    slot_t const* find(Symbol) const;
+    void          push_back(meta_data const&, var_t const&);
 
     static common_t smooth(std::vector<AST::VarDecl> const&);
     static common_t smooth(AST::FormalList const&);
@@ -38,56 +63,79 @@ class method_spec
     class_spec const& cls;
 
   public:
-    method_spec(meta_data const&, class_spec const&,
-                std::string const&, memory_layout&&,
-                memory_layout::common_t&&, AST::Type);
-    method_spec(meta_data const&, class_spec const&,
-                std::string const&, memory_layout const&,
-                memory_layout::common_t&&, AST::Type);
-
-    std::string const             name;
+    method_spec(meta_data const&, class_spec const&, Symbol,
+                memory_layout&&, memory_layout::common_t&&,
+                AST::TypeRef);
+    method_spec(meta_data const&, class_spec const&, Symbol,
+                memory_layout const&, memory_layout::common_t&&,
+                AST::TypeRef);
+
+    Symbol const                  name;
     memory_layout const           layout;
     memory_layout::common_t const arglist;
-    AST::Type                     return_type;
+    AST::TypeRef                  return_type;
+
+    // The class that defines the method
+    class_spec const& owner() const { return cls; }
 };
 
+// A class only keeps what it declares itself. Names it inherits are
+// looked up in its base classes, so an inherited method is the very
+// method_spec of the class that defines it, never a copy. The tables
+// grow with the definitions, not with definitions times subclasses;
+// in exchange a lookup that misses costs one probe per ancestor.
 class class_spec
 {
-    meta_data const&              data;
-    std::map<std::string, kind_t> kind;
-    std::map<std::string, int>    m_id;
-    std::vector<method_spec>      m_info;
+    meta_data const&                   data;
+    class_spec const*                  parent;
+    std::unordered_map<Symbol, kind_t> kind;
+    std::unordered_map<Symbol, int>    m_id;
+    std::vector<method_spec>           m_info;
 
-    void init_methods(std::vector<AST::MethodDecl> const&);
-    void insert_method(std::string const&, memory_layout&&,
-                       memory_layout::common_t&&, AST::Type);
-    void insert_method(std::string const&, method_spec const&);
+    void insert_method(Symbol, memory_layout&&,
+                       memory_layout::common_t&&, AST::TypeRef);
 
   public:
+    // The fields only: the methods come once every class has its
+    // size, because their locals may be of any class
     class_spec(meta_data const&, AST::MainClassRule const&);
     class_spec(meta_data const&, AST::ClassDeclNoInheritance const&);
     class_spec(meta_data const&, AST::ClassDeclInheritance const&);
+    void init_methods(std::vector<AST::MethodDecl> const&);
 
-    int    size() const;
-    kind_t operator[](const std::string&) const;
+    int     size() const;
+    kind_t  operator[](Symbol) const;
+    binding resolve(Symbol mtd, Symbol name) const;
 
-    std::string const&       name;
-    int                      base;
-    memory_layout const      variable;
-    method_spec&             method(std::string const&);
-    method_spec const&       method(std::string const&) const;
-    std::vector<std::string> methods;
+    Symbol const        name;
+    int                 base;
+    memory_layout const variable;
+    method_spec const&  method(Symbol) const;
+    std::vector<Symbol> methods;
 };
 
+// Each class is allocated on its own, so it stays put when the whole
+// meta_data is moved and the classes can refer to one another.
+//
+// The classes are laid out level by level of the class graph, and
+// the classes of one level at the same time, on as many threads as
+// asked for. The methods of all classes are laid out last, also at
+// the same time. The result does not depend on the number of
+// threads.
 class meta_data
 {
-    std::vector<class_spec>    c_info;
-    std::map<std::string, int> c_id;
+    std::vector<std::unique_ptr<class_spec>> c_info;
+    std::unordered_map<Symbol, int>          c_id;
+
+    void build(AST::ProgramRule const&, ThreadPool&);
 
   public:
     friend class class_spec;
-    meta_data(const AST::Program&);
+    meta_data(const AST::Program&, unsigned threads = 1);
     meta_data();
+    meta_data(meta_data const&) = delete;
+    meta_data(meta_data&&)      = default;
+    meta_data& operator=(meta_data&&) = default;
 
     void operator()(const AST::integerArrayType&);
     void operator()(const AST::booleanType&);
@@ -98,18 +146,18 @@ class meta_data
     void operator()(const AST::ClassDeclNoInheritance&);
     void operator()(const AST::ClassDeclInheritance&);
     void operator()(const AST::MainClassRule&);
-    void operator()(const AST::ProgramRule&);
 
-    int               count(std::string const&) const;
-    class_spec&       operator[](std::string const&);
-    class_spec const& operator[](std::string const&) const;
+    int               count(Symbol) const;
+    class_spec&       operator[](Symbol);
+    class_spec const& operator[](Symbol) const;
     class_spec&       operator[](int);
     class_spec const& operator[](int) const;
-    int               type_size(std::string const&) const;
-    int               type_size(AST::Type const&) const;
+    int               type_size(Symbol) const;
+    int               type_size(AST::TypeRef) const;
 };
 
-std::string mangle(std::string, std::string);
+// The label of a method
+Symbol mangle(Symbol, Symbol);
 } // namespace helper
 
 #endif
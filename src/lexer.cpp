@@ -1,93 +1,264 @@
 #include "lexer.h"
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
 
-Trie::Trie(const std::vector<std::string>& words) {
-    root = std::make_unique<Trie::Node>();
-    for (size_t i = 0; i < words.size(); i++) {
-        Node* node = root.get();
-        for (char c : words[i]) {
-            int j = static_cast<int>(c);
-            if (!node->child[j])
-                node->child[j] = std::make_unique<Trie::Node>();
-            node = node->child[j].get();
-        }
-        node->child[0]        = std::make_unique<Trie::Node>();
-        node->child[0]->label = static_cast<Lexeme>(
-            static_cast<int>(Lexeme::boolean_keyword) + i);
-    }
-}
-
-Lexer::Lexer(std::istream* _in, size_t _la)
-    : symbols(reserved_words), in(_in), lo(0), la(_la), lc(0), pos(0),
+Lexer::Lexer(std::string_view _text, size_t _la, bool _intern)
+    : text(_text), lo(0), la(_la), lc(1), pos(0), intern(_intern),
       LA(la) {
     for (size_t i = 0; i < la; i++) LA[i] = advance();
 }
 
-LexState Lexer::operator[](size_t i) { return LA[(pos + i) % la]; }
+LexState const& Lexer::operator[](size_t i) const {
+    return LA[(pos + i) % la];
+}
 
 LexState Lexer::advance() {
     if (LA[pos].first == Lexeme::eof) return LA[pos];
-    while (true) {
-        if (lo == line.size()) {
-            std::getline(*in, line);
-            lo = 0;
-            if (!in->good()) return {Lexeme::eof, std::string(), lc};
-            lc++;
+    while (lo < text.size()) {
+        if (Scan::is(Scan::space, text[lo])) {
+            size_t hi = consume(Scan::space);
+            size_t nl = std::count(text.begin() + lo,
+                                   text.begin() + hi, '\n');
+            // A trailing newline does not start a new line
+            if (hi == text.size() && text.back() == '\n') nl--;
+            lc += nl;
+            lo = hi;
+            continue;
         }
-        while (lo < line.size()) {
-            while (lo < line.size() && isspace(line[lo])) lo++;
-            if (lo == line.size()) break;
-
-            if (ispunct(line[lo])) {
-                // Still need to fix /* */ comment style
-                std::string word(line, lo, 2);
-                auto        lex = symbols.search(word.c_str());
-                if (lex == Lexeme::identifier) {
-                    word = std::string(line, lo, 1);
-                    lex  = symbols.search(word.c_str());
-                } else if (lex == Lexeme::inline_comment) {
-                    lo = line.size();
-                    continue; // NON-OBVIOUS CONTROL FLOW
-                }
-                lo += word.size();
-                return {lex, word, lc};
-            }
 
-            if (isdigit(line[lo])) {
-                size_t hi =
-                    consume([](char c) { return isdigit(c); });
-                std::string word(line, lo, hi - lo);
-                lo += word.size();
-                return {Lexeme::integer_literal, word, lc};
+        if (Scan::is(Scan::punct, text[lo])) {
+            // Still need to fix /* */ comment style
+            auto word = text.substr(lo, 2);
+            auto lex  = Keywords::classify(word);
+            if (lex == Lexeme::identifier) {
+                word = text.substr(lo, 1);
+                lex  = Keywords::classify(word);
+            } else if (lex == Lexeme::inline_comment) {
+                lo = consume(Scan::line);
+                continue; // NON-OBVIOUS CONTROL FLOW
             }
+            lo += word.size();
+            return {lex, word, lc};
+        }
 
-            if (isalpha(line[lo])) {
-                std::string word(line, lo, 18);
-                auto        lex = symbols.search(word.c_str());
-                if (lex == Lexeme::println_keyword) {
-                    lo += 18;
-                    return {lex, word, lc};
-                }
-
-                size_t hi = consume(
-                    [](char c) { return isalnum(c) || c == '_'; });
-                word = std::string(line, lo, hi - lo);
-                lex  = symbols.search(word.c_str());
-                lo += word.size();
+        if (Scan::is(Scan::digit, text[lo])) {
+            size_t hi   = consume(Scan::digit);
+            auto   word = text.substr(lo, hi - lo);
+            lo          = hi;
+            return {Lexeme::integer_literal, word, lc};
+        }
+
+        if (Scan::is(Scan::alpha, text[lo])) {
+            auto word = text.substr(lo, 18);
+            auto lex  = Keywords::classify(word);
+            if (lex == Lexeme::println_keyword) {
+                lo += 18;
                 return {lex, word, lc};
             }
-            __builtin_unreachable();
+
+            size_t hi = consume(Scan::word);
+            word = text.substr(lo, hi - lo);
+            lex  = Keywords::classify(word);
+            lo   = hi;
+            if (lex != Lexeme::identifier || !intern)
+                return {lex, word, lc};
+            return {lex, word, lc, word};
         }
+        __builtin_unreachable();
     }
+    return {Lexeme::eof, std::string_view(), lc};
+}
+
+size_t Lexer::consume(Scan::CharClass cls) const {
+    return Scan::span(cls, text, lo);
 }
 
 bool Lexer::empty() const { return LA[pos].first == Lexeme::eof; }
 
 size_t Lexer::line_count() const { return LA[pos].third; }
 
-LexState Lexer::operator*() { return LA[pos]; }
+LexState const& Lexer::operator*() const { return LA[pos]; }
 
 Lexer& Lexer::operator++() {
     LA[pos] = advance();
     pos     = (pos + 1) % la;
     return *this;
 }
+
+namespace {
+// No token spans a newline, so cutting right after one is safe. Every
+// piece but the last ends in '\n' and none is empty.
+std::vector<size_t> cut(std::string_view text, unsigned pieces) {
+    std::vector<size_t> cuts{0};
+    size_t const        step = text.size() / std::max(pieces, 1u);
+    for (unsigned k = 1; k < pieces; k++) {
+        size_t nl = text.find('\n', std::max(k * step, cuts.back()));
+        if (nl == std::string_view::npos || nl + 1 >= text.size())
+            break;
+        cuts.push_back(nl + 1);
+    }
+    cuts.push_back(text.size());
+    return cuts;
+}
+
+// What the serial lexer interns: identifiers spelled as words. A
+// punctuation mark it does not know, like a lone '/', also comes out
+// as an identifier, but without a symbol.
+bool is_name(LexState const& tok) {
+    return tok.first == Lexeme::identifier &&
+           Scan::is(Scan::alpha, tok.second[0]);
+}
+
+// Tokens of one piece, with lines counted from the start of the piece
+// and identifiers numbered in the order they first appear in it.
+struct Piece {
+    std::vector<Lexeme>           kind;
+    std::vector<uint32_t>         offset, length, line, local;
+    std::vector<std::string_view> names;
+    size_t                        newlines;
+
+    void lex(std::string_view text, size_t lo, size_t hi) {
+        auto const piece = text.substr(lo, hi - lo);
+        newlines = std::count(piece.begin(), piece.end(), '\n');
+
+        std::unordered_map<std::string_view, uint32_t> seen;
+        for (Lexer lex(piece, 1, false); !lex.empty(); ++lex) {
+            auto const& tok = *lex;
+            kind.push_back(tok.first);
+            offset.push_back(tok.second.data() - text.data());
+            length.push_back(tok.second.size());
+            line.push_back(tok.third);
+            if (!is_name(tok)) {
+                local.push_back(0);
+                continue;
+            }
+            uint32_t next = names.size() + 1;
+            uint32_t id   = seen.emplace(tok.second, next).first->second;
+            if (id == next) names.push_back(tok.second);
+            local.push_back(id);
+        }
+    }
+};
+} // namespace
+
+TokenBuffer::TokenBuffer(std::string_view _text, unsigned threads)
+    : text(_text) {
+    if (text.size() > UINT32_MAX)
+        throw std::length_error(
+            "TokenBuffer: a source must be smaller than 4 GiB");
+    if (threads == 0) threads = concurrency(text.size());
+    auto const cuts = cut(text, threads);
+    if (cuts.size() > 2)
+        lex_parallel(cuts);
+    else
+        lex_serial();
+}
+
+void TokenBuffer::lex_serial() {
+    // Roughly one token every five bytes of real code
+    size_t guess = text.size() / 5 + 1;
+    kind.reserve(guess);
+    offset.reserve(guess);
+    length.reserve(guess);
+    line.reserve(guess);
+    symbol.reserve(guess);
+
+    for (Lexer lex(text);; ++lex) {
+        auto const& tok = *lex;
+        kind.push_back(tok.first);
+        // eof has no spelling, so place it at the end
+        offset.push_back(tok.second.data()
+                             ? tok.second.data() - text.data()
+                             : text.size());
+        length.push_back(tok.second.size());
+        line.push_back(tok.third);
+        symbol.push_back(tok.fourth);
+        if (tok.first == Lexeme::eof) break;
+    }
+}
+
+void TokenBuffer::lex_parallel(std::vector<size_t> const& cuts) {
+    std::vector<Piece> pieces(cuts.size() - 1);
+    {
+        std::vector<std::thread> workers;
+        for (size_t k = 1; k < pieces.size(); k++)
+            workers.emplace_back([&, k] {
+                pieces[k].lex(text, cuts[k], cuts[k + 1]);
+            });
+        pieces[0].lex(text, cuts[0], cuts[1]);
+        for (auto& w : workers) w.join();
+    }
+
+    size_t total = 1;
+    for (auto const& p : pieces) total += p.kind.size();
+    kind.reserve(total);
+    offset.reserve(total);
+    length.reserve(total);
+    line.reserve(total);
+    symbol.reserve(total);
+
+    // Interning piece by piece, in order, hands out the same ids as
+    // a single pass over the text would
+    size_t lines = 0;
+    for (auto const& p : pieces) {
+        std::vector<Symbol> global{Symbol()};
+        for (auto name : p.names) global.emplace_back(name);
+
+        kind.insert(kind.end(), p.kind.begin(), p.kind.end());
+        offset.insert(offset.end(), p.offset.begin(), p.offset.end());
+        length.insert(length.end(), p.length.begin(), p.length.end());
+        for (size_t i = 0; i < p.kind.size(); i++) {
+            line.push_back(p.line[i] + lines);
+            symbol.push_back(global[p.local[i]]);
+        }
+        lines += p.newlines;
+    }
+
+    // The last piece does not count its trailing newline, if any
+    if (text.back() == '\n') lines--;
+    kind.push_back(Lexeme::eof);
+    offset.push_back(text.size());
+    length.push_back(0);
+    line.push_back(lines + 1);
+    symbol.push_back(Symbol());
+}
+
+unsigned TokenBuffer::concurrency(size_t bytes) {
+    // Below a few megabytes, threads cost more than they save
+    size_t const wanted = bytes / (4 << 20);
+    size_t const cores  = std::thread::hardware_concurrency();
+    return std::max<size_t>(1, std::min(wanted, cores));
+}
+
+size_t TokenBuffer::size() const { return kind.size(); }
+
+LexState TokenBuffer::operator[](size_t i) const {
+    return {kind[i], text.substr(offset[i], length[i]), line[i],
+            symbol[i]};
+}
+
+TokenCursor::TokenCursor(TokenBuffer const& _tokens)
+    : tokens(&_tokens), pos(0) {}
+
+bool TokenCursor::empty() const { return kind() == Lexeme::eof; }
+
+Lexeme TokenCursor::kind(size_t i) const {
+    return tokens->kind[std::min(pos + i, tokens->size() - 1)];
+}
+
+LexState TokenCursor::operator*() const { return (*this)[0]; }
+
+LexState TokenCursor::operator[](size_t i) const {
+    return (*tokens)[std::min(pos + i, tokens->size() - 1)];
+}
+
+size_t TokenCursor::line_count() const {
+    return tokens->line[std::min(pos, tokens->size() - 1)];
+}
+
+TokenCursor& TokenCursor::operator++() {
+    if (pos + 1 < tokens->size()) pos++;
+    return *this;
+}
@@ -1,15 +1,15 @@
 #ifndef BCC_LEXER
 #define BCC_LEXER
 
+#include "scan.h"
+#include "symbol.h"
+#include <array>
 #include <cinttypes>
-#include <istream>
-#include <limits>
-#include <memory>
-#include <string>
+#include <string_view>
 #include <vector>
 
 // clang-format off
-const static std::vector<std::string> reserved_words = {
+constexpr std::array<std::string_view, 36> reserved_words = {
     "boolean",
     "class",
     "else",
@@ -50,7 +50,7 @@ const static std::vector<std::string> reserved_words = {
 // clang-format on
 
 // ORDER HERE IS IMPORTANT
-enum class Lexeme {
+enum class Lexeme : uint8_t {
     identifier,
     integer_literal,
 
@@ -110,61 +110,125 @@ ostream& operator<<(ostream& out, Lexeme lex) {
     return out;
 }
 
-class Trie {
-    template <typename T> using ptr = std::unique_ptr<T>;
-    struct Node {
-        Lexeme    label = Lexeme::identifier;
-        ptr<Node> child[1 + std::numeric_limits<char>::max()];
-    };
-    ptr<Node> root;
+namespace Keywords {
+// Reserved words are told apart by their length, first and last
+// characters. Multiplying that key by the constant below sends each of
+// them to its own slot of a 64 entry table, so a lookup is a hash and
+// at most one comparison.
+constexpr uint32_t hash(std::string_view w) {
+    uint32_t key = uint32_t(w.size()) << 16 |
+                   uint32_t(uint8_t(w.front())) << 8 |
+                   uint32_t(uint8_t(w.back()));
+    return (key * 0xf10391b9u) >> 26;
+}
 
-  public:
-    Trie(const std::vector<std::string>& words);
-    template <typename It> Lexeme search(It) const;
+struct Slot {
+    std::string_view word;
+    Lexeme           lex = Lexeme::identifier;
 };
 
+constexpr std::array<Slot, 64> make_table() {
+    std::array<Slot, 64> table{};
+    for (size_t i = 0; i < reserved_words.size(); i++)
+        table[hash(reserved_words[i])] = {reserved_words[i],
+                                          Lexeme(i + 2)};
+    return table;
+}
+
+constexpr std::array<Slot, 64> table = make_table();
+
+constexpr Lexeme classify(std::string_view w) {
+    if (w.empty()) return Lexeme::identifier;
+    auto const& slot = table[hash(w)];
+    return slot.word == w ? slot.lex : Lexeme::identifier;
+}
+
+// No two reserved words may share a slot, and each one must classify
+// as the Lexeme at its position in reserved_words.
+constexpr bool keeps_order() {
+    for (size_t i = 0; i < reserved_words.size(); i++)
+        if (classify(reserved_words[i]) != Lexeme(i + 2))
+            return false;
+    return reserved_words.size() + 2 == size_t(Lexeme::eof);
+}
+static_assert(keeps_order(), "reserved_words is out of sync");
+} // namespace Keywords
+
+// A token. The text is a view into the Source the Lexer reads from,
+// so it is only valid while that Source is alive. Identifiers are
+// also interned, which outlives the Source.
 struct LexState {
-    Lexeme      first;
-    std::string second;
-    size_t      third;
+    Lexeme           first;
+    std::string_view second;
+    size_t           third;
+    Symbol           fourth = {};
 
-    explicit operator Lexeme() { return first; }
+    explicit operator Lexeme() const { return first; }
 };
 
+// Lexes a contiguous buffer, usually the view of a Source. Tokens
+// are produced without any heap allocation, except for the first
+// time an identifier is interned. Without interning, identifiers
+// are left with an empty symbol.
 class Lexer {
-    Trie                  symbols;
-    std::istream*         in;
+    std::string_view      text;
     size_t                lo, la, lc, pos;
-    std::string           line;
+    bool                  intern;
     std::vector<LexState> LA;
 
-    template <typename F> size_t consume(F f);
-    LexState                     advance();
+    size_t   consume(Scan::CharClass) const;
+    LexState advance();
 
   public:
-    Lexer(std::istream*, size_t lookahead = 1);
-    bool     empty() const;
-    LexState operator*();
-    LexState operator[](size_t i);
-    size_t   line_count() const;
-    Lexer&   operator++();
+    Lexer(std::string_view, size_t lookahead = 1, bool intern = true);
+    bool            empty() const;
+    LexState const& operator*() const;
+    LexState const& operator[](size_t i) const;
+    size_t          line_count() const;
+    Lexer&          operator++();
 };
 
-template <typename It> Lexeme Trie::search(It q) const {
-    Node* node = root.get();
-    while (*q) {
-        if (node->child[static_cast<int>(*q)])
-            node = node->child[static_cast<int>(*q++)].get();
-        else
-            return Lexeme::identifier;
-    }
-    if (!node->child[0]) return Lexeme::identifier;
-    return node->child[0]->label;
-}
+// A whole buffer lexed up front into parallel arrays. Token i is
+// kind[i], spelled text.substr(offset[i], length[i]) on line[i];
+// symbol[i] is set for identifiers only. The last token is eof.
+struct TokenBuffer {
+    std::string_view      text;
+    std::vector<Lexeme>   kind;
+    std::vector<uint32_t> offset;
+    std::vector<uint32_t> length;
+    std::vector<uint32_t> line;
+    std::vector<Symbol>   symbol;
+
+    // With more than one thread, the text is cut on newlines and the
+    // pieces are lexed concurrently. The result is the same either
+    // way, down to the order symbols are interned in. Zero threads
+    // means as many as concurrency() suggests. Offsets are 32 bits,
+    // so a text of 4 GiB or more throws std::length_error.
+    explicit TokenBuffer(std::string_view, unsigned threads = 0);
+    size_t   size() const;
+    LexState operator[](size_t i) const;
+
+    // Threads worth using for a text of the given size
+    static unsigned concurrency(size_t bytes);
+
+  private:
+    void lex_serial();
+    void lex_parallel(std::vector<size_t> const& cuts);
+};
 
-template <typename F> size_t Lexer::consume(F f) {
-    size_t hi = lo;
-    while (hi < line.size() && f(line[hi])) hi++;
-    return hi;
-}
+// Walks a TokenBuffer with the interface of a Lexer, but with any
+// lookahead. Looking past the end gives the final eof.
+class TokenCursor {
+    TokenBuffer const* tokens;
+    size_t             pos;
+
+  public:
+    explicit TokenCursor(TokenBuffer const&);
+    bool         empty() const;
+    Lexeme       kind(size_t i = 0) const;
+    LexState     operator*() const;
+    LexState     operator[](size_t i) const;
+    size_t       line_count() const;
+    TokenCursor& operator++();
+};
 #endif
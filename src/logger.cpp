@@ -1,8 +1,29 @@
 #include "logger.h"
 
-Logger::Logger(std::vector<AST::ErrorData>& _in) : errors(_in) {}
+void Diagnostics::add(int id, std::unique_ptr<AST::ParsingError> err)
+{
+    by_id[id].push_back(std::move(err));
+}
+
+bool Diagnostics::has_errors() const { return !by_id.empty(); }
+
+size_t Diagnostics::size() const
+{
+    size_t n = 0;
+    for (auto const& [id, errs] : by_id) n += errs.size();
+    return n;
+}
+
+AST::ErrorData const& Diagnostics::operator[](int id) const
+{
+    static AST::ErrorData const none;
+    auto it = by_id.find(id);
+    return it == by_id.end() ? none : it->second;
+}
+
+Logger::Logger(Diagnostics& _in) : errors(_in) {}
 
-void Logger::push(std::string label, int line)
+void Logger::push(Symbol label, int line)
 {
     context.push_back(label);
     lines.push_back(line);
@@ -20,7 +41,7 @@ void Logger::mismatch(Lexeme expected, Lexeme found, int id)
     err->inner = AST::Mismatch{found, expected};
     err->lines = lines;
     err->ctx   = context;
-    errors[id].push_back(std::move(err));
+    errors.add(id, std::move(err));
 }
 
 void Logger::mismatch(std::string expected, std::string found, int id)
@@ -29,7 +50,7 @@ void Logger::mismatch(std::string expected, std::string found, int id)
     err->inner = AST::WrongIdentifier{expected, found};
     err->lines = lines;
     err->ctx   = context;
-    errors[id].push_back(std::move(err));
+    errors.add(id, std::move(err));
 }
 
 void Logger::unexpected(Lexeme un, int id)
@@ -39,5 +60,5 @@ void Logger::unexpected(Lexeme un, int id)
     err->inner = AST::Unexpected{un};
     err->lines = lines;
     err->ctx   = context;
-    errors[id].push_back(std::move(err));
+    errors.add(id, std::move(err));
 }
@@ -1,15 +1,30 @@
 #ifndef BCC_LOGGER
 #define BCC_LOGGER
 #include "AST.h"
+#include <unordered_map>
+
+// Parsing errors by the id of the node they were found in. Almost
+// every node is clean, so only nodes with errors take up space.
+class Diagnostics {
+    std::unordered_map<int, AST::ErrorData> by_id;
+
+  public:
+    void   add(int id, std::unique_ptr<AST::ParsingError> err);
+    bool   has_errors() const;
+    size_t size() const;
+
+    // The errors of one node, empty for almost all of them
+    AST::ErrorData const& operator[](int id) const;
+};
 
 class Logger {
-    std::vector<int32_t>         lines;
-    std::vector<std::string>     context;
-    std::vector<AST::ErrorData>& errors;
+    std::vector<int32_t> lines;
+    std::vector<Symbol>  context;
+    Diagnostics&         errors;
 
   public:
-    Logger(std::vector<AST::ErrorData>&);
-    void push(std::string label, int line);
+    Logger(Diagnostics&);
+    void push(Symbol label, int line);
     void pop();
     void mismatch(Lexeme expected, Lexeme found, int id);
     void mismatch(std::string expected, std::string found, int id);
@@ -3,6 +3,7 @@
 #include "parser.h"
 #include "translate.h"
 #include "util.h"
+#include <fstream>
 
 int main(int argc, char** argv)
 {
@@ -23,17 +24,30 @@ int main(int argc, char** argv)
     for (int i = 3; i < argc; i++)
         if (argv[i][0] == 'f') final_ir = true;
 
+    unsigned threads = 1;
+    for (int i = 3; i < argc; i++)
+        if (argv[i][0] == 'p') threads = 0;
+
     TranslationUnit tu(std::string{argv[1]});
     IR::Tree        tree;
-    translate(tree, tu.syntax_tree);
+    try {
+        translate(tree, tu.syntax_tree, threads);
+    } catch (helper::cyclic_classes const& err) {
+        for (auto const& cycle : err.cycles) {
+            std::cerr << "These classes depend on each other:";
+            for (auto const& name : cycle) std::cerr << ' ' << name;
+            std::cerr << '\n';
+        }
+        return 1;
+    }
 
     if (debug) {
         IR::Tree cp = tree;
         Util::write(std::cerr, "Base Tree");
-        cp.dump(std::cerr);
+        cp.dump(std::cerr, threads);
         cp.simplify();
         Util::write(std::cerr, "Simplified Tree");
-        cp.dump(std::cerr);
+        cp.dump(std::cerr, threads);
     }
 
     std::ofstream out(argv[2]);
@@ -41,7 +55,7 @@ int main(int argc, char** argv)
 
     if (final_ir) {
         Util::write(std::cerr, "Final Tree");
-        tree.dump(std::cerr);
+        tree.dump(std::cerr, threads);
     }
 
     code.output();
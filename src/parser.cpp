@@ -1,64 +1,150 @@
 #include "parser.h"
 #include "Builder.h"
 
-AST::Exp Parser::_Exp(AST::Exp&& lhs)
+// Context labels, interned once so that entering a rule costs no
+// string work. They are only spelled out when an error is printed.
+namespace label
+{
+Symbol const expression("Expression");
+Symbol const call_list("Method Call List");
+Symbol const statement("Statement");
+Symbol const type("Type");
+Symbol const argument_list("Method Argument List");
+Symbol const var_decl("Variable Declaration");
+Symbol const method_decl("Method Declaration");
+Symbol const class_decl("Class Declaration");
+Symbol const main_class("Main Class");
+} // namespace label
+
+// Binding power of a binary operator, or 0 if lex is not one
+static int precedence(Lexeme lex)
+{
+    switch (lex) {
+    case Lexeme::and_operator:
+        return 1;
+    case Lexeme::less_operator:
+        return 2;
+    case Lexeme::plus_operator:
+    case Lexeme::minus_operator:
+        return 3;
+    case Lexeme::times_operator:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+AST::Exp Parser::_Binary(Lexeme op, AST::Exp&& lhs, AST::Exp&& rhs)
 {
     using std::move;
     AST::Builder builder(*this);
-    builder << std::move(lhs);
-    switch (Lexeme(tokens[0])) {
+    builder << move(lhs) << move(rhs);
+    switch (op) {
     case Lexeme::and_operator:
-        builder << Lexeme::and_operator << Exp();
-        return _Exp(AST::andExp(move(builder)));
+        return AST::andExp(move(builder));
     case Lexeme::less_operator:
-        builder << Lexeme::less_operator << Exp();
-        return _Exp(AST::lessExp(move(builder)));
+        return AST::lessExp(move(builder));
     case Lexeme::plus_operator:
-        builder << Lexeme::plus_operator << Exp();
-        return _Exp(AST::sumExp(move(builder)));
+        return AST::sumExp(move(builder));
     case Lexeme::minus_operator:
-        builder << Lexeme::minus_operator << Exp();
-        return _Exp(AST::minusExp(move(builder)));
-    case Lexeme::times_operator:
-        builder << Lexeme::times_operator << Exp();
-        return _Exp(AST::prodExp(move(builder)));
-    case Lexeme::open_bracket:
-        builder << Lexeme::open_bracket << Exp()
-                << Lexeme::close_bracket;
-        return _Exp(AST::indexingExp(move(builder)));
-    case Lexeme::period:
-        builder << Lexeme::period;
-        if (Lexeme(tokens[0]) == Lexeme::lenght_keyword) {
+        return AST::minusExp(move(builder));
+    default:
+        return AST::prodExp(move(builder));
+    }
+}
+
+// Indexing, .length and method calls, applied left to right
+AST::Exp Parser::_Postfix(AST::Exp&& lhs)
+{
+    using std::move;
+    while (tokens.kind() == Lexeme::open_bracket ||
+           tokens.kind() == Lexeme::period) {
+        AST::Builder builder(*this);
+        if (tokens.kind() == Lexeme::open_bracket) {
+            builder << move(lhs) << Lexeme::open_bracket << Exp()
+                    << Lexeme::close_bracket;
+            lhs = AST::indexingExp(move(builder));
+            continue;
+        }
+        builder << move(lhs) << Lexeme::period;
+        if (tokens.kind() == Lexeme::lenght_keyword) {
             builder << Lexeme::lenght_keyword;
-            return _Exp(AST::lengthExp(move(builder)));
+            lhs = AST::lengthExp(move(builder));
+        } else {
+            builder << Lexeme::identifier << ExpList();
+            lhs = AST::methodCallExp(move(builder));
+        }
+    }
+    return move(lhs);
+}
+
+AST::Exp Parser::_Unary()
+{
+    if (tokens.kind() != Lexeme::bang) return _Postfix(_Primary());
+    AST::Builder builder(*this);
+    builder << Lexeme::bang << _Unary();
+    return AST::bangExp(std::move(builder));
+}
+
+AST::Exp Parser::_Primary()
+{
+    using std::move;
+    AST::Builder builder(*this);
+    switch (tokens.kind()) {
+    case Lexeme::integer_literal:
+        builder << Lexeme::integer_literal;
+        return AST::integerExp(move(builder));
+    case Lexeme::true_keyword:
+        builder << Lexeme::true_keyword;
+        return AST::trueExp(move(builder));
+    case Lexeme::false_keyword:
+        builder << Lexeme::false_keyword;
+        return AST::falseExp(move(builder));
+    case Lexeme::identifier:
+        builder << Lexeme::identifier;
+        return AST::identifierExp(move(builder));
+    case Lexeme::this_keyword:
+        builder << Lexeme::this_keyword;
+        return AST::thisExp(move(builder));
+    case Lexeme::new_keyword:
+        builder << Lexeme::new_keyword;
+        if (tokens.kind() == Lexeme::int_keyword) {
+            builder << Lexeme::int_keyword << Lexeme::open_bracket
+                    << Exp() << Lexeme::close_bracket;
+            return AST::newArrayExp(move(builder));
         }
-        builder << Lexeme::identifier << ExpList();
-        return _Exp(AST::methodCallExp(move(builder)));
+        builder << Lexeme::identifier << Lexeme::open_paren
+                << Lexeme::close_paren;
+        return AST::newObjectExp(move(builder));
+    case Lexeme::open_paren:
+        builder << Lexeme::open_paren << Exp() << Lexeme::close_paren;
+        return AST::parenExp(move(builder));
     default:
-        return builder.lhs();
+        builder.unexpected(tokens.kind());
+        return AST::falseExp(move(builder));
     }
 }
 
-void Parser::record_context(std::string label)
+void Parser::record_context(Symbol label)
 {
-    logger.push(label, tokens[0].third);
+    logger.push(label, tokens.line_count());
 }
 
 void Parser::drop_context() { logger.pop(); }
 
 void Parser::mismatch(Lexeme lex, int id)
 {
-    logger.mismatch(lex, Lexeme(tokens[0]), id);
-    while (Lexeme(tokens[0]) != Lexeme::eof &&
-           Lexeme(tokens[0]) != lex)
+    logger.mismatch(lex, tokens.kind(), id);
+    while (tokens.kind() != Lexeme::eof &&
+           tokens.kind() != lex)
         ++tokens;
 }
 
 void Parser::mismatch(std::string in, int id)
 {
-    logger.mismatch(in, tokens[0].second, id);
-    while (Lexeme(tokens[0]) != Lexeme::eof &&
-           !(Lexeme(tokens[0]) == Lexeme::identifier &&
+    logger.mismatch(in, std::string(tokens[0].second), id);
+    while (tokens.kind() != Lexeme::eof &&
+           !(tokens.kind() == Lexeme::identifier &&
              tokens[0].second == in))
         ++tokens;
 }
@@ -70,66 +156,73 @@ void Parser::unexpected(Lexeme un, int id)
 }
 
 Parser::Parser(std::istream* stream)
-    : tokens(stream, 2), idx(0), logger(errors)
+    : source(stream), buffer(source.view()), tokens(buffer), idx(0),
+      logger(errors)
 {
 }
 
 Parser::Parser(std::string const& filename, std::istream* stream)
-    : tokens(stream, 2), idx(0), logger(errors)
+    : source(stream), buffer(source.view()), tokens(buffer), idx(0),
+      logger(errors)
 {
     logger.push(filename, -1);
 }
 
-LexState Parser::operator[](int i) { return tokens[i]; }
+Parser::Parser(std::string const& filename, std::string_view text)
+    : source(Source::borrow(text)), buffer(source.view()),
+      tokens(buffer), idx(0), logger(errors)
+{
+    logger.push(filename, -1);
+}
 
+LexState Parser::operator[](int i) const { return tokens[i]; }
+
+// Operator precedence parsing with explicit stacks, so long chains
+// like a + b + ... + z need no recursion and come out left-leaning.
+// From loosest to tightest: &&, <, + and -, *, then unary !. The
+// stacks are the parser's scratch ones, used from their current top
+// and cut back on the way out, as a Builder does.
 AST::Exp Parser::Exp()
 {
-    using std::move;
-    AST::Builder builder(*this, "Expression");
-    switch (Lexeme(tokens[0])) {
-    case Lexeme::integer_literal:
-        builder << Lexeme::integer_literal;
-        return _Exp(AST::integerExp(move(builder)));
-    case Lexeme::true_keyword:
-        builder << Lexeme::true_keyword;
-        return _Exp(AST::trueExp(move(builder)));
-    case Lexeme::false_keyword:
-        builder << Lexeme::false_keyword;
-        return _Exp(AST::falseExp(move(builder)));
-    case Lexeme::identifier:
-        builder << Lexeme::identifier;
-        return _Exp(AST::identifierExp(move(builder)));
-    case Lexeme::this_keyword:
-        builder << Lexeme::this_keyword;
-        return _Exp(AST::thisExp(move(builder)));
-    case Lexeme::new_keyword:
-        builder << Lexeme::new_keyword;
-        if (Lexeme(tokens[0]) == Lexeme::int_keyword) {
-            builder << Lexeme::int_keyword << Lexeme::open_bracket
-                    << Exp() << Lexeme::close_bracket;
-            return _Exp(AST::newArrayExp(move(builder)));
-        }
-        builder << Lexeme::identifier << Lexeme::open_paren
-                << Lexeme::close_paren;
-        return _Exp(AST::newObjectExp(move(builder)));
-    case Lexeme::bang:
-        builder << Lexeme::bang << Exp();
-        return _Exp(AST::bangExp(move(builder)));
-    case Lexeme::open_paren:
-        builder << Lexeme::open_paren << Exp() << Lexeme::close_paren;
-        return _Exp(AST::parenExp(move(builder)));
-    default:
-        builder.unexpected(Lexeme(tokens[0]));
-        return AST::falseExp(move(builder));
+    record_context(label::expression);
+    auto&        operands  = std::get<std::vector<AST::Exp>>(scratch);
+    auto&        operators = std::get<std::vector<Lexeme>>(scratch);
+    size_t const base      = operators.size();
+
+    auto reduce = [&] {
+        auto rhs = std::move(operands.back());
+        operands.pop_back();
+        auto lhs = std::move(operands.back());
+        operands.pop_back();
+        auto op = operators.back();
+        operators.pop_back();
+        operands.push_back(
+            _Binary(op, std::move(lhs), std::move(rhs)));
+    };
+
+    operands.push_back(_Unary());
+    while (int prec = precedence(tokens.kind())) {
+        while (operators.size() > base &&
+               precedence(operators.back()) >= prec)
+            reduce();
+        operators.push_back(tokens.kind());
+        ++tokens;
+        operands.push_back(_Unary());
     }
+    while (operators.size() > base) reduce();
+
+    drop_context();
+    auto ans = std::move(operands.back());
+    operands.pop_back();
+    return ans;
 }
 
 AST::ExpList Parser::ExpList()
 {
-    AST::Builder builder(*this, "Method Call List");
+    AST::Builder builder(*this, label::call_list);
     builder << Lexeme::open_paren;
     bool first = true;
-    while (Lexeme(tokens[0]) != Lexeme::close_paren) {
+    while (tokens.kind() != Lexeme::close_paren) {
         if (!first) builder << Lexeme::comma;
         first = false;
         builder << Exp();
@@ -141,11 +234,11 @@ AST::ExpList Parser::ExpList()
 AST::Stm Parser::Stm()
 {
     using std::move;
-    AST::Builder builder(*this, "Statement");
-    switch (Lexeme(tokens[0])) {
+    AST::Builder builder(*this, label::statement);
+    switch (tokens.kind()) {
     case Lexeme::open_brace:
         builder << Lexeme::open_brace;
-        while (Lexeme(tokens[0]) != Lexeme::close_brace)
+        while (tokens.kind() != Lexeme::close_brace)
             builder << Stm();
         builder << Lexeme::close_brace;
         return AST::blockStm(move(builder));
@@ -164,7 +257,7 @@ AST::Stm Parser::Stm()
         return AST::printStm(move(builder));
     case Lexeme::identifier:
         builder << Lexeme::identifier;
-        if (Lexeme(tokens[0]) == Lexeme::equals_sign) {
+        if (tokens.kind() == Lexeme::equals_sign) {
             builder << Lexeme::equals_sign << Exp()
                     << Lexeme::semicolon;
             return AST::assignStm(move(builder));
@@ -174,15 +267,15 @@ AST::Stm Parser::Stm()
                 << Exp() << Lexeme::semicolon;
         return AST::indexAssignStm(move(builder));
     default:
-        builder.unexpected(Lexeme(tokens[0]));
+        builder.unexpected(tokens.kind());
         return AST::blockStm(move(builder));
     }
 }
 
 AST::Type Parser::Type()
 {
-    AST::Builder builder(*this, "Type");
-    switch (Lexeme(tokens[0])) {
+    AST::Builder builder(*this, label::type);
+    switch (tokens.kind()) {
     case Lexeme::boolean_keyword:
         builder << Lexeme::boolean_keyword;
         return AST::booleanType(std::move(builder));
@@ -191,23 +284,23 @@ AST::Type Parser::Type()
         return AST::classType(std::move(builder));
     case Lexeme::int_keyword:
         builder << Lexeme::int_keyword;
-        if (Lexeme(tokens[0]) == Lexeme::open_bracket) {
+        if (tokens.kind() == Lexeme::open_bracket) {
             builder << Lexeme::open_bracket << Lexeme::close_bracket;
             return AST::integerArrayType(std::move(builder));
         }
         return AST::integerType(std::move(builder));
     default:
-        builder.unexpected(Lexeme(tokens[0]));
+        builder.unexpected(tokens.kind());
         return AST::integerType(std::move(builder));
     }
 }
 
 AST::FormalList Parser::FormalList()
 {
-    AST::Builder builder(*this, "Method Argument List");
+    AST::Builder builder(*this, label::argument_list);
     builder << Lexeme::open_paren;
     bool first = true;
-    while (Lexeme(tokens[0]) != Lexeme::close_paren) {
+    while (tokens.kind() != Lexeme::close_paren) {
         if (!first) builder << Lexeme::comma;
         first = false;
         builder << Type() << Lexeme::identifier;
@@ -218,25 +311,25 @@ AST::FormalList Parser::FormalList()
 
 AST::VarDecl Parser::VarDecl()
 {
-    AST::Builder builder(*this, "Variable Declaration");
+    AST::Builder builder(*this, label::var_decl);
     builder << Type() << Lexeme::identifier << Lexeme::semicolon;
     return AST::VarDeclRule(std::move(builder));
 }
 
 AST::MethodDecl Parser::MethodDecl()
 {
-    AST::Builder builder(*this, "Method Declaration");
+    AST::Builder builder(*this, label::method_decl);
     builder << Lexeme::public_keyword << Type() << Lexeme::identifier
             << FormalList() << Lexeme::open_brace;
 
-    while (Lexeme(tokens[0]) == Lexeme::boolean_keyword ||
-           Lexeme(tokens[0]) == Lexeme::int_keyword ||
-           (Lexeme(tokens[0]) == Lexeme::identifier &&
-            Lexeme(tokens[1]) == Lexeme::identifier))
+    while (tokens.kind() == Lexeme::boolean_keyword ||
+           tokens.kind() == Lexeme::int_keyword ||
+           (tokens.kind() == Lexeme::identifier &&
+            tokens.kind(1) == Lexeme::identifier))
         builder << VarDecl();
 
-    while (Lexeme(tokens[0]) != Lexeme::return_keyword &&
-           Lexeme(tokens[0]) != Lexeme::eof)
+    while (tokens.kind() != Lexeme::return_keyword &&
+           tokens.kind() != Lexeme::eof)
         builder << Stm();
     builder << Lexeme::return_keyword << Exp() << Lexeme::semicolon
             << Lexeme::close_brace;
@@ -245,23 +338,23 @@ AST::MethodDecl Parser::MethodDecl()
 
 AST::ClassDecl Parser::ClassDecl()
 {
-    AST::Builder builder(*this, "Class Declaration");
+    AST::Builder builder(*this, label::class_decl);
     builder << Lexeme::class_keyword << Lexeme::identifier;
 
     bool has_superclass =
-        (Lexeme(tokens[0]) == Lexeme::extends_keyword);
+        (tokens.kind() == Lexeme::extends_keyword);
 
     if (has_superclass)
         builder << Lexeme::extends_keyword << Lexeme::identifier;
 
     builder << Lexeme::open_brace;
-    while (Lexeme(tokens[0]) != Lexeme::close_brace &&
-           Lexeme(tokens[0]) != Lexeme::public_keyword &&
-           Lexeme(tokens[0]) != Lexeme::eof)
+    while (tokens.kind() != Lexeme::close_brace &&
+           tokens.kind() != Lexeme::public_keyword &&
+           tokens.kind() != Lexeme::eof)
         builder << VarDecl();
 
-    while (Lexeme(tokens[0]) != Lexeme::close_brace &&
-           Lexeme(tokens[0]) != Lexeme::eof)
+    while (tokens.kind() != Lexeme::close_brace &&
+           tokens.kind() != Lexeme::eof)
         builder << MethodDecl();
     builder << Lexeme::close_brace;
 
@@ -273,7 +366,7 @@ AST::ClassDecl Parser::ClassDecl()
 
 AST::MainClass Parser::MainClass()
 {
-    AST::Builder builder(*this, "Main Class");
+    AST::Builder builder(*this, label::main_class);
     builder << Lexeme::class_keyword << Lexeme::identifier
             << Lexeme::open_brace << Lexeme::public_keyword
             << Lexeme::static_keyword << Lexeme::void_keyword
@@ -289,18 +382,20 @@ AST::Program Parser::Program()
 {
     AST::Builder builder(*this);
     builder << MainClass();
-    while (Lexeme(tokens[0]) != Lexeme::eof) builder << ClassDecl();
+    while (tokens.kind() != Lexeme::eof) builder << ClassDecl();
     return AST::ProgramRule(std::move(builder));
 }
 
 TranslationUnit::TranslationUnit(std::string name)
-    : filename(name), stream(filename, std::ios::in),
-      parser(filename, &stream), syntax_tree(parser.Program())
+    : filename(name), source(filename),
+      parser(filename, source.view()), syntax_tree(parser.Program())
 {
 }
 
 bool TranslationUnit::check()
 {
+    // Only a broken program needs the walk that puts errors in order
+    if (!parser.errors.has_errors()) return true;
     Reporter rep(std::cout, parser.errors);
     Grammar::visit(rep, syntax_tree);
     return rep;
@@ -3,14 +3,17 @@
 #include "AST.h"
 #include "error.h"
 #include "logger.h"
+#include "source.h"
 #include "util.h"
-#include <fstream>
 
 class Parser
 {
-    AST::Exp _Exp(AST::Exp&& lhs);
+    AST::Exp _Unary();
+    AST::Exp _Primary();
+    AST::Exp _Postfix(AST::Exp&& lhs);
+    AST::Exp _Binary(Lexeme op, AST::Exp&& lhs, AST::Exp&& rhs);
 
-    void record_context(std::string label);
+    void record_context(Symbol label);
     void drop_context();
     void mismatch(Lexeme lex, int id);
     void mismatch(std::string in, int id);
@@ -19,7 +22,8 @@ class Parser
   public:
     Parser(std::istream*);
     Parser(std::string const&, std::istream*);
-    LexState operator[](int i);
+    Parser(std::string const&, std::string_view);
+    LexState operator[](int i) const;
     friend class AST::Builder;
 
     AST::Exp        Exp();
@@ -34,19 +38,24 @@ class Parser
     AST::Program    Program();
 
   public:
-    std::vector<AST::ErrorData> errors;
+    Diagnostics errors;
 
   private:
-    Lexer  tokens;
-    int    idx;
-    Logger logger;
+    // The trees the parser returns live here, so they go with it
+    Grammar::Arena nodes;
+    Source         source;
+    TokenBuffer    buffer;
+    TokenCursor    tokens;
+    int            idx;
+    Logger         logger;
+    AST::Scratch   scratch;
 };
 
 class TranslationUnit
 {
-    std::string   filename;
-    std::ifstream stream;
-    Parser        parser;
+    std::string filename;
+    Source      source;
+    Parser      parser;
 
   public:
     AST::Program syntax_tree;
@@ -0,0 +1,175 @@
+#include "scan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BCC_SCAN_X86
+#endif
+
+namespace Scan
+{
+
+static size_t span_scalar(CharClass cls, std::string_view text,
+                          size_t lo)
+{
+    while (lo < text.size() && is(cls, text[lo])) lo++;
+    return lo;
+}
+
+#ifdef BCC_SCAN_X86
+
+// Every vector path computes a mask of the bytes in the class and
+// stops at the first zero bit. Ranges are tested with the unsigned
+// trick: lo <= c <= hi iff c - lo <= hi - lo, and x <= k iff
+// max(x, k) == k.
+
+__attribute__((target("sse2"))) static inline __m128i
+in_range(__m128i v, char lo, char hi)
+{
+    __m128i k = _mm_set1_epi8(hi - lo);
+    __m128i x = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_max_epu8(x, k), k);
+}
+
+template <CharClass cls>
+__attribute__((target("sse2"))) static inline __m128i
+members(__m128i v)
+{
+    switch (cls) {
+    case space:
+        return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                            in_range(v, '\t', '\r'));
+    case digit:
+        return in_range(v, '0', '9');
+    case word: {
+        __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        return _mm_or_si128(
+            _mm_or_si128(in_range(v, '0', '9'),
+                         in_range(lower, 'a', 'z')),
+            _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+    }
+    case line:
+        return _mm_xor_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                             _mm_set1_epi8(-1));
+    default:
+        return _mm_setzero_si128();
+    }
+}
+
+template <CharClass cls>
+__attribute__((target("sse2"))) static size_t
+span_sse2(std::string_view text, size_t lo)
+{
+    char const* p = text.data();
+    while (lo + 16 <= text.size()) {
+        __m128i  v    = _mm_loadu_si128((__m128i const*)(p + lo));
+        unsigned mask = _mm_movemask_epi8(members<cls>(v));
+        if (mask != 0xFFFF) return lo + __builtin_ctz(~mask);
+        lo += 16;
+    }
+    return span_scalar(cls, text, lo);
+}
+
+__attribute__((target("avx2"))) static inline __m256i
+in_range(__m256i v, char lo, char hi)
+{
+    __m256i k = _mm256_set1_epi8(hi - lo);
+    __m256i x = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_max_epu8(x, k), k);
+}
+
+template <CharClass cls>
+__attribute__((target("avx2"))) static inline __m256i
+members(__m256i v)
+{
+    switch (cls) {
+    case space:
+        return _mm256_or_si256(
+            _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+            in_range(v, '\t', '\r'));
+    case digit:
+        return in_range(v, '0', '9');
+    case word: {
+        __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        return _mm256_or_si256(
+            _mm256_or_si256(in_range(v, '0', '9'),
+                            in_range(lower, 'a', 'z')),
+            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+    }
+    case line:
+        return _mm256_xor_si256(
+            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+            _mm256_set1_epi8(-1));
+    default:
+        return _mm256_setzero_si256();
+    }
+}
+
+template <CharClass cls>
+__attribute__((target("avx2"))) static size_t
+span_avx2(std::string_view text, size_t lo)
+{
+    char const* p = text.data();
+    while (lo + 32 <= text.size()) {
+        __m256i  v    = _mm256_loadu_si256((__m256i const*)(p + lo));
+        unsigned mask = _mm256_movemask_epi8(members<cls>(v));
+        if (mask != 0xFFFFFFFF) return lo + __builtin_ctz(~mask);
+        lo += 32;
+    }
+    return span_sse2<cls>(text, lo);
+}
+#endif
+
+Isa best()
+{
+#ifdef BCC_SCAN_X86
+    static Isa const isa = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return Isa::avx2;
+        if (__builtin_cpu_supports("sse2")) return Isa::sse2;
+        return Isa::scalar;
+    }();
+    return isa;
+#else
+    return Isa::scalar;
+#endif
+}
+
+template <CharClass cls>
+static size_t span(Isa isa, std::string_view text, size_t lo)
+{
+    switch (isa) {
+#ifdef BCC_SCAN_X86
+    case Isa::avx2:
+        return span_avx2<cls>(text, lo);
+    case Isa::sse2:
+        return span_sse2<cls>(text, lo);
+#endif
+    default:
+        return span_scalar(cls, text, lo);
+    }
+}
+
+size_t span(Isa isa, CharClass cls, std::string_view text, size_t lo)
+{
+    // Tokens are short; only go wide when the first byte is in
+    if (lo >= text.size() || !is(cls, text[lo])) return lo;
+    switch (cls) {
+    case space:
+        return span<space>(isa, text, lo);
+    case digit:
+        return span<digit>(isa, text, lo);
+    case word:
+        return span<word>(isa, text, lo);
+    case line:
+        return span<line>(isa, text, lo);
+    default:
+        return span_scalar(cls, text, lo);
+    }
+}
+
+size_t span(CharClass cls, std::string_view text, size_t lo)
+{
+    return span(best(), cls, text, lo);
+}
+
+} // namespace Scan
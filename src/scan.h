@@ -0,0 +1,60 @@
+#ifndef BCC_SCAN
+#define BCC_SCAN
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+// ASCII character classes for the lexer. Unlike <cctype>, they do not
+// depend on the locale, and runs of them can be skipped 16 or 32
+// bytes at a time.
+namespace Scan
+{
+
+enum CharClass : uint8_t {
+    space = 1,  // ' ', '\t', '\n', '\v', '\f', '\r'
+    digit = 2,  // '0' to '9'
+    alpha = 4,  // 'a' to 'z' and 'A' to 'Z'
+    punct = 8,  // printable, but neither alpha nor digit
+    word  = 16, // alpha, digit or '_'
+    line  = 32  // anything but '\n'
+};
+
+constexpr std::array<uint8_t, 256> make_table()
+{
+    std::array<uint8_t, 256> table{};
+    for (int c = 0; c < 256; c++) {
+        bool    d = '0' <= c && c <= '9';
+        bool    a = ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z');
+        uint8_t f = 0;
+        if (c == ' ' || ('\t' <= c && c <= '\r')) f |= space;
+        if (d) f |= digit;
+        if (a) f |= alpha;
+        if (d || a || c == '_') f |= word;
+        if ('!' <= c && c <= '~' && !d && !a) f |= punct;
+        if (c != '\n') f |= line;
+        table[c] = f;
+    }
+    return table;
+}
+
+constexpr std::array<uint8_t, 256> table = make_table();
+
+constexpr bool is(CharClass cls, char c)
+{
+    return table[static_cast<uint8_t>(c)] & cls;
+}
+
+enum class Isa { scalar, sse2, avx2 };
+
+// Widest implementation the running CPU supports
+Isa best();
+
+// Position of the first character of text at or after lo that is
+// not in cls, or text.size() if there is none. Only space, digit,
+// word and line runs have vector paths.
+size_t span(CharClass cls, std::string_view text, size_t lo);
+size_t span(Isa, CharClass cls, std::string_view text, size_t lo);
+
+} // namespace Scan
+#endif
@@ -0,0 +1,67 @@
+#include "source.h"
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+void Source::adopt_buffer()
+{
+    data   = buffer.data();
+    length = buffer.size();
+}
+
+Source::Source(std::string const& filename)
+    : data(nullptr), length(0), mapped(false)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1) return;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        if (st.st_size == 0) {
+            close(fd);
+            return;
+        }
+        void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE,
+                          fd, 0);
+        if (addr != MAP_FAILED) {
+            madvise(addr, st.st_size, MADV_SEQUENTIAL);
+            data   = static_cast<const char*>(addr);
+            length = st.st_size;
+            mapped = true;
+        }
+    }
+    close(fd);
+
+    // Pipes and the like cannot be mapped
+    if (!mapped) {
+        std::ifstream in(filename, std::ios::in | std::ios::binary);
+        buffer.assign(std::istreambuf_iterator<char>(in), {});
+        adopt_buffer();
+    }
+}
+
+Source::Source(std::istream* in) : mapped(false)
+{
+    buffer.assign(std::istreambuf_iterator<char>(*in), {});
+    adopt_buffer();
+}
+
+Source::Source(const char* _data, size_t _length)
+    : data(_data), length(_length), mapped(false)
+{
+}
+
+Source Source::borrow(std::string_view text)
+{
+    return Source(text.data(), text.size());
+}
+
+Source::~Source()
+{
+    if (mapped) munmap(const_cast<char*>(data), length);
+}
+
+std::string_view Source::view() const { return {data, length}; }
@@ -0,0 +1,32 @@
+#ifndef BCC_SOURCE
+#define BCC_SOURCE
+
+#include <istream>
+#include <string>
+#include <string_view>
+
+// The whole text of a translation unit, in one contiguous buffer.
+// Files are memory-mapped, so tokens can be views into the mapping;
+// streams are read once into an owned string. Source::borrow wraps
+// text that someone else owns.
+class Source
+{
+    const char* data;
+    size_t      length;
+    bool        mapped;
+    std::string buffer;
+
+    Source(const char*, size_t);
+    void adopt_buffer();
+
+  public:
+    explicit Source(std::string const& filename);
+    explicit Source(std::istream*);
+    Source(Source const&) = delete;
+    Source& operator=(Source const&) = delete;
+    ~Source();
+
+    static Source    borrow(std::string_view);
+    std::string_view view() const;
+};
+#endif
@@ -0,0 +1,63 @@
+#include "symbol.h"
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace
+{
+// The deque never moves its strings, so the views used as keys and
+// the references handed out by str() stay valid.
+struct Interner {
+    std::shared_mutex                              lock;
+    std::deque<std::string>                        names;
+    std::unordered_map<std::string_view, uint32_t> ids;
+
+    Interner() { insert({}); }
+
+    uint32_t insert(std::string_view s)
+    {
+        auto const& name = names.emplace_back(s);
+        return ids.emplace(name, names.size() - 1).first->second;
+    }
+};
+
+Interner& table()
+{
+    static Interner interner;
+    return interner;
+}
+} // namespace
+
+uint32_t Symbol::intern(std::string_view s)
+{
+    auto& t = table();
+    {
+        std::shared_lock<std::shared_mutex> read(t.lock);
+        auto                                it = t.ids.find(s);
+        if (it != t.ids.end()) return it->second;
+    }
+    std::unique_lock<std::shared_mutex> write(t.lock);
+    auto                                it = t.ids.find(s);
+    if (it != t.ids.end()) return it->second;
+    return t.insert(s);
+}
+
+std::string const& Symbol::str() const
+{
+    auto&                               t = table();
+    std::shared_lock<std::shared_mutex> read(t.lock);
+    return t.names[id];
+}
+
+size_t Symbol::count()
+{
+    auto&                               t = table();
+    std::shared_lock<std::shared_mutex> read(t.lock);
+    return t.names.size();
+}
+
+std::ostream& operator<<(std::ostream& out, Symbol s)
+{
+    return out << s.str();
+}
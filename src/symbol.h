@@ -0,0 +1,78 @@
+#ifndef BCC_SYMBOL
+#define BCC_SYMBOL
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// An interned identifier. Every distinct spelling is stored once in a
+// process-wide table, so symbols compare and hash as integers. Ids
+// are handed out in first-seen order and the empty string is 0.
+class Symbol
+{
+    uint32_t id;
+
+    static uint32_t intern(std::string_view);
+
+  public:
+    Symbol() : id(0) {}
+    Symbol(std::string_view s) : id(intern(s)) {}
+    Symbol(std::string const& s) : id(intern(s)) {}
+    Symbol(const char* s) : id(intern(s)) {}
+
+    uint32_t           index() const { return id; }
+    std::string const& str() const;
+    bool               empty() const { return id == 0; }
+
+    // Number of symbols interned so far
+    static size_t count();
+
+    // Orders by spelling. The ids depend on what the process happened
+    // to intern first, so anything written out goes by this instead.
+    struct by_name {
+        bool operator()(Symbol a, Symbol b) const
+        {
+            return a.str() < b.str();
+        }
+    };
+
+    friend bool operator==(Symbol a, Symbol b)
+    {
+        return a.id == b.id;
+    }
+    friend bool operator!=(Symbol a, Symbol b)
+    {
+        return a.id != b.id;
+    }
+    friend bool operator<(Symbol a, Symbol b) { return a.id < b.id; }
+
+    // Comparing against plain text does not intern it
+    friend bool operator==(Symbol a, std::string_view b)
+    {
+        return a.str() == b;
+    }
+    friend bool operator==(Symbol a, std::string const& b)
+    {
+        return a.str() == b;
+    }
+    friend bool operator==(Symbol a, const char* b)
+    {
+        return a.str() == b;
+    }
+    template <typename T> friend bool operator!=(Symbol a, T const& b)
+    {
+        return !(a == b);
+    }
+};
+
+std::ostream& operator<<(std::ostream&, Symbol);
+
+namespace std
+{
+template <> struct hash<Symbol> {
+    size_t operator()(Symbol s) const noexcept { return s.index(); }
+};
+} // namespace std
+#endif
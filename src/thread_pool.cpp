@@ -0,0 +1,76 @@
+#include "thread_pool.h"
+#include <algorithm>
+#include <utility>
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned k = 1; k < threads; k++)
+        workers.emplace_back([this] { work(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stop = true;
+    }
+    wake.notify_all();
+    for (auto& w : workers) w.join();
+}
+
+unsigned ThreadPool::size() const { return workers.size() + 1; }
+
+void ThreadPool::run(size_t n, std::function<void(size_t)> const& f)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        job     = &f;
+        count   = n;
+        pending = workers.size();
+        failed  = n;
+        error   = nullptr;
+        next    = 0;
+        round++;
+    }
+    wake.notify_all();
+    drain();
+
+    std::unique_lock<std::mutex> guard(lock);
+    done.wait(guard, [this] { return pending == 0; });
+    job = nullptr;
+    if (error) std::rethrow_exception(std::exchange(error, nullptr));
+}
+
+void ThreadPool::work()
+{
+    size_t seen = 0;
+    for (;;) {
+        std::unique_lock<std::mutex> guard(lock);
+        wake.wait(guard, [&] { return stop || round != seen; });
+        if (stop) return;
+        seen = round;
+        guard.unlock();
+        drain();
+        guard.lock();
+        if (--pending == 0) done.notify_all();
+    }
+}
+
+// Indices are handed out one at a time, so a slow call does not hold
+// up the ones after it
+void ThreadPool::drain()
+{
+    for (size_t i; (i = next++) < count;) {
+        try {
+            (*job)(i);
+        } catch (...) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (i < failed) {
+                failed = i;
+                error  = std::current_exception();
+            }
+        }
+    }
+}
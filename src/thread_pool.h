@@ -0,0 +1,47 @@
+#ifndef BCC_THREAD_POOL
+#define BCC_THREAD_POOL
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads. run(n, f) calls f(0) .. f(n - 1),
+// spread over the workers and the calling thread, and returns once
+// all of them have. A pool of one thread has no workers and run is
+// a plain loop. If some calls throw, run rethrows the exception of
+// the lowest index, which is the one a plain loop would have hit
+// first, so the outcome does not depend on the number of threads.
+class ThreadPool
+{
+    std::vector<std::thread>           workers;
+    std::mutex                         lock;
+    std::condition_variable            wake;
+    std::condition_variable            done;
+    std::function<void(size_t)> const* job = nullptr;
+    size_t                             count   = 0;
+    size_t                             pending = 0;
+    size_t                             round   = 0;
+    bool                               stop    = false;
+    std::atomic<size_t>                next{0};
+    size_t                             failed = 0;
+    std::exception_ptr                 error;
+
+    void work();
+    void drain();
+
+  public:
+    // Zero threads means one per core
+    explicit ThreadPool(unsigned threads = 1);
+    ~ThreadPool();
+    ThreadPool(ThreadPool const&) = delete;
+
+    unsigned size() const;
+    void     run(size_t n, std::function<void(size_t)> const& f);
+};
+
+#endif
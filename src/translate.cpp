@@ -1,11 +1,28 @@
 #include "translate.h"
+#include "thread_pool.h"
 
 namespace IR
 {
 
-Translator::Translator(Tree& tree) : t(tree) {}
-Translator::Translator(Tree& tree, helper::meta_data&& d)
-    : t(tree), data(std::move(d))
+// Bare expressions and statements have no program around them
+static helper::meta_data const& no_data()
+{
+    static helper::meta_data const data;
+    return data;
+}
+static TypeChecker const& no_types()
+{
+    static TypeChecker const types;
+    return types;
+}
+
+Translator::Translator(Tree& tree)
+    : Translator(tree, no_data(), no_types())
+{
+}
+Translator::Translator(Tree& tree, helper::meta_data const& d,
+                       TypeChecker const& ty)
+    : t(tree), data(d), types(ty)
 {
 }
 
@@ -78,7 +95,7 @@ int Translator::operator()(AST::lessExp const& exp)
                                 << Grammar::visit(*this, exp.rhs);
                             return cmp.build();
                         }())
-       << Grammar::visit(*this, AST::Exp{AST::trueExp{}});
+       << (*this)(AST::trueExp{});
 
     return bn.build();
 }
@@ -89,26 +106,22 @@ int Translator::operator()(AST::bangExp const& exp)
 
     bn << IR::IRTag::BINOP << IR::BinopId::XOR
        << Grammar::visit(*this, exp.inner)
-       << Grammar::visit(*this, AST::Exp{AST::trueExp{}});
+       << (*this)(AST::trueExp{});
 
     return bn.build();
 }
 
 int Translator::operator()(AST::identifierExp const& exp)
 {
-    if (frame.arguments.count(exp.value))
-        return frame.arguments[exp.value];
+    auto const var =
+        data[current_class].resolve(current_method, exp.value);
+    if (var.where == helper::binding::argument)
+        return arguments[var.offset];
 
     int pt  = -1;
-    int dsp = 0;
-    if (data[current_class]
-            .method(current_method)
-            .layout.has(exp.value))
-        pt = frame.sp, dsp = data[current_class]
-                                 .method(current_method)
-                                 .layout[exp.value];
-    else if (data[current_class].variable.has(exp.value))
-        pt = frame.tp, dsp = data[current_class].variable[exp.value];
+    int dsp = var.offset;
+    if (var.where == helper::binding::local) pt = frame.sp;
+    if (var.where == helper::binding::field) pt = frame.tp;
 
     IRBuilder mem(t);
     IRBuilder binop(t);
@@ -124,22 +137,17 @@ int Translator::operator()(AST::identifierExp const& exp)
 int Translator::operator()(AST::thisExp const&) { return frame.tp; }
 int Translator::operator()(AST::methodCallExp const& exp)
 {
-    auto const& cls_name =
-        Grammar::get<AST::classType>(
-            Grammar::visit(TypeInferenceVisitor{*this}, exp.object))
-            .value;
+    auto const cls_name = types[exp.object].name();
     auto const& es =
         Grammar::get<AST::ExpListRule>(exp.arguments).exps;
 
     IRBuilder call(t);
     call << IRTag::CALL << helper::mangle(cls_name, exp.name) << [&] {
-        Explist args;
-        args.push_back(
-            store_in_temp(t, Grammar::visit(*this, exp.object)));
+        ExplistBuilder args(t);
+        args << store_in_temp(t, Grammar::visit(*this, exp.object));
         for (auto const& e : es)
-            args.push_back(
-                store_in_temp(t, Grammar::visit(*this, e)));
-        return t.keep_explist(std::move(args));
+            args << store_in_temp(t, Grammar::visit(*this, e));
+        return args.build();
     }();
 
     return store_in_temp(t, call.build());
@@ -205,39 +213,32 @@ int Translator::operator()(AST::whileStm const& wst)
 }
 int Translator::operator()(AST::assignStm const& ast)
 {
-    auto lhs_exp = AST::Exp{AST::identifierExp{ast.name}};
-
-    auto lhs_t = Grammar::visit(TypeInferenceVisitor{*this}, lhs_exp);
-    auto rhs_t =
-        Grammar::visit(TypeInferenceVisitor{*this}, ast.value);
+    // The type checker made sure both sides have the same type
+    auto const lhs_t = types[ast.id];
 
-    if (Grammar::index(lhs_t) != Grammar::index(rhs_t)) throw;
-
-    auto lhs = Grammar::visit(*this, lhs_exp);
+    auto lhs = (*this)(AST::identifierExp{ast.name});
     auto rhs = Grammar::visit(*this, ast.value);
 
-    if (Grammar::holds<AST::classType>(lhs_t)) {
-        auto const& cls_name =
-            Grammar::get<AST::classType>(lhs_t).value;
+    if (lhs_t.kind() == AST::TypeRef::object) {
+        auto const cls_name = lhs_t.name();
 
         if (t.get_type(lhs) == IR::IRTag::MEM)
             lhs = t.get_mem(lhs).exp;
 
-        Explist args;
-        args.push_back(store_in_temp(t, lhs));
-        args.push_back(store_in_temp(t, rhs));
-        args.push_back([&] {
+        ExplistBuilder args(t);
+        args << store_in_temp(t, lhs) << store_in_temp(t, rhs);
+        args << [&] {
             IRBuilder cte(t);
             cte << IR::IRTag::CONST << data[cls_name].size();
             return cte.build();
-        }());
+        }();
 
-        auto explist = t.keep_explist(std::move(args));
+        auto explist = args.build();
 
         IRBuilder exp(t);
         exp << IR::IRTag::EXP << [&] {
             IRBuilder call(t);
-            call << IR::IRTag::CALL << std::string("memcpy")
+            call << IR::IRTag::CALL << Symbol("memcpy")
                  << explist;
             return call.build();
         }();
@@ -257,9 +258,11 @@ int Translator::operator()(AST::printStm const& stm)
     exp << IR::IRTag::EXP << [&] {
         IRBuilder builder(t);
 
-        builder << IR::IRTag::CALL << std::string("print");
-        builder << t.keep_explist(Explist{
-            store_in_temp(t, Grammar::visit(*this, stm.exp))});
+        ExplistBuilder args(t);
+        args << store_in_temp(t, Grammar::visit(*this, stm.exp));
+
+        builder << IR::IRTag::CALL << Symbol("print");
+        builder << args.build();
         return builder.build();
     }();
     return exp.build();
@@ -272,13 +275,15 @@ int Translator::operator()(AST::newObjectExp const& noe)
         IRBuilder cte(t);
         cte << IR::IRTag::CONST << data[noe.value].size();
 
-        call << IR::IRTag::CALL << std::string("malloc")
-             << t.keep_explist(Explist{cte.build()});
+        ExplistBuilder args(t);
+        args << cte.build();
+
+        call << IR::IRTag::CALL << Symbol("malloc") << args.build();
         return call.build();
     }());
 }
 
-fragmentGuard::fragmentGuard(Tree& _t, std::string _l,
+fragmentGuard::fragmentGuard(Tree& _t, Symbol _l,
                              IR::activation_record _r)
     : t(_t), label(_l), rec(_r)
 {
@@ -300,48 +305,53 @@ int Translator::operator()(AST::MethodDeclRule const& mdr)
         8 * (data[current_class].method(current_method).layout.size)};
 
     auto flr = Grammar::get<AST::FormalListRule>(mdr.arguments);
-    for (auto const& d : flr.decls)
-        frame.arguments.insert({d.name, t.new_temp()});
+    arguments.clear();
+    for (auto const& d : flr.decls) {
+        arguments.push_back(t.new_temp());
+        frame.arguments.insert({d.name, arguments.back()});
+    }
 
     fragmentGuard guard(
         t, helper::mangle(current_class, current_method), frame);
 
     for (auto const& stm : mdr.body) Grammar::visit(*this, stm);
 
-    auto ret_t =
-        Grammar::visit(TypeInferenceVisitor{*this}, mdr.return_exp);
-
     IRBuilder ret(t);
     ret << IRTag::EXP << Grammar::visit(*this, mdr.return_exp);
     ret.build();
 
     return 0;
 }
+int Translator::method(Symbol cls, AST::MethodDecl const& mtd)
+{
+    current_class = cls;
+    return Grammar::visit(*this, mtd);
+}
+void Translator::inherit(AST::ClassDeclInheritance const& cls)
+{
+    auto const& spec = data[cls.name];
+    for (int b = spec.base; b != -1; b = data[b].base)
+        for (auto const& mtd : data[b].methods) {
+            auto const& owner = spec.method(mtd).owner();
+            if (&owner == &spec) continue;
+            t.aliases[helper::mangle(owner.name, mtd)].insert(
+                helper::mangle(cls.name, mtd));
+        }
+}
 int Translator::operator()(AST::ClassDeclNoInheritance const& cls)
 {
-    current_class = cls.name;
-    for (auto const& mtd : cls.methods) Grammar::visit(*this, mtd);
+    for (auto const& mtd : cls.methods) method(cls.name, mtd);
     return 0;
 }
 int Translator::operator()(AST::ClassDeclInheritance const& cls)
 {
-    current_class = cls.name;
-    for (auto const& mtd : cls.methods) Grammar::visit(*this, mtd);
-    for (auto const& mtd : data[current_class].methods)
-        if (data[current_class][mtd] == helper::kind_t::method_inh)
-            for (int b = data[current_class].base; b != -1;
-                 b     = data[b].base) {
-                if (data[b][mtd] == helper::kind_t::method_def) {
-                    t.aliases[helper::mangle(data[b].name, mtd)]
-                        .insert(helper::mangle(cls.name, mtd));
-                    break;
-                }
-            }
+    for (auto const& mtd : cls.methods) method(cls.name, mtd);
+    inherit(cls);
     return 0;
 }
 int Translator::operator()(AST::MainClassRule const& mc)
 {
-    fragmentGuard guard(t, std::string("main"),
+    fragmentGuard guard(t, Symbol("main"),
                         {{}, t.new_temp(), t.new_temp(), 0});
 
     Grammar::visit(*this, mc.body);
@@ -365,162 +375,48 @@ int translate(Tree& t, AST::Stm const& stm)
     return Grammar::visit(Translator{t}, stm);
 }
 
-void translate(Tree& t, AST::Program const& p)
-{
-    Grammar::visit(Translator{t, helper::meta_data(p)}, p);
-}
-
-AST::Type TypeInferenceVisitor::
-          operator()(AST::methodCallExp const& exp)
-{
-    auto obj = Grammar::get<AST::classType>(
-        Grammar::visit(*this, exp.object));
-
-    int  cnt     = 0;
-    auto explist = [&] {
-        helper::memory_layout::common_t ans;
-        for (auto const& e :
-             Grammar::get<AST::ExpListRule>(exp.arguments).exps)
-            ans.push_back(
-                {Grammar::visit(*this, e), std::to_string(cnt++)});
-        return ans;
-    }();
-
-    for (int i = 0; i < cnt; i++)
-        if (Grammar::index(explist[i].type) !=
-            Grammar::index(translator.data[obj.value]
-                               .method(exp.name)
-                               .arglist[i]
-                               .type))
-            throw;
-
-    return translator.data[obj.value].method(exp.name).return_type;
-}
-
-AST::Type TypeInferenceVisitor::operator()(AST::thisExp const&)
-{
-    return AST::classType{translator.current_class};
-}
-
-AST::Type TypeInferenceVisitor::
-          operator()(AST::identifierExp const& exp)
-{
-    helper::memory_layout::common_t dft;
-
-    auto const& source = [&] {
-        if (translator.frame.arguments.count(exp.value))
-            return translator.data[translator.current_class]
-                .method(translator.current_method)
-                .arglist;
-
-        if (translator.data[translator.current_class]
-                .method(translator.current_method)
-                .layout.has(exp.value))
-            return translator.data[translator.current_class]
-                .method(translator.current_method)
-                .layout.source;
-
-        if (translator.data[translator.current_class].variable.has(
-                exp.value))
-            return translator.data[translator.current_class]
-                .variable.source;
-        return dft;
-    }();
-    if (!source.size()) throw;
-
-    for (auto const& [type, name] : source)
-        if (name == exp.value) return type;
-    throw;
-}
-
-AST::Type TypeInferenceVisitor::operator()(AST::andExp const& exp)
+void translate(Tree& t, AST::Program const& p, unsigned threads)
 {
-    type_assert<AST::booleanType>(Grammar::visit(*this, exp.lhs));
-    type_assert<AST::booleanType>(Grammar::visit(*this, exp.rhs));
-    return AST::booleanType{};
-}
-
-AST::Type TypeInferenceVisitor::operator()(AST::lessExp const& exp)
-{
-    type_assert<AST::integerType>(Grammar::visit(*this, exp.lhs));
-    type_assert<AST::integerType>(Grammar::visit(*this, exp.rhs));
-    return AST::booleanType{};
-}
-
-AST::Type TypeInferenceVisitor::operator()(AST::sumExp const& exp)
-{
-    type_assert<AST::integerType>(Grammar::visit(*this, exp.lhs));
-    type_assert<AST::integerType>(Grammar::visit(*this, exp.rhs));
-    return AST::integerType{};
-}
-
-AST::Type TypeInferenceVisitor::operator()(AST::minusExp const& exp)
-{
-    type_assert<AST::integerType>(Grammar::visit(*this, exp.lhs));
-    type_assert<AST::integerType>(Grammar::visit(*this, exp.rhs));
-    return AST::integerType{};
-}
+    helper::meta_data data(p, threads);
+    TypeChecker       types(data, p, threads);
+    Translator        translator(t, data, types);
 
-AST::Type TypeInferenceVisitor::operator()(AST::prodExp const& exp)
-{
-    type_assert<AST::integerType>(Grammar::visit(*this, exp.lhs));
-    type_assert<AST::integerType>(Grammar::visit(*this, exp.rhs));
-    return AST::integerType{};
-}
-
-AST::Type TypeInferenceVisitor::
-          operator()(AST::indexingExp const& exp)
-{
-    type_assert<AST::integerArrayType>(
-        Grammar::visit(*this, exp.lhs));
-    type_assert<AST::integerType>(Grammar::visit(*this, exp.rhs));
-    return AST::integerType{};
-}
-
-AST::Type TypeInferenceVisitor::operator()(AST::lengthExp const& exp)
-{
-    type_assert<AST::integerArrayType>(
-        Grammar::visit(*this, exp.inner));
-    return AST::integerType{};
-}
-
-AST::Type TypeInferenceVisitor::operator()(AST::integerExp const&)
-{
-    return AST::integerType{};
-}
-
-AST::Type TypeInferenceVisitor::operator()(AST::trueExp const&)
-{
-    return AST::booleanType{};
-}
-
-AST::Type TypeInferenceVisitor::operator()(AST::falseExp const&)
-{
-    return AST::booleanType{};
-}
-
-AST::Type TypeInferenceVisitor::
-          operator()(AST::newArrayExp const& exp)
-{
-    type_assert<AST::integerType>(Grammar::visit(*this, exp.inner));
-    return AST::integerArrayType{};
-}
-
-AST::Type TypeInferenceVisitor::
-          operator()(AST::newObjectExp const& exp)
-{
-    return AST::classType{exp.value};
-}
-
-AST::Type TypeInferenceVisitor::operator()(AST::bangExp const& exp)
-{
-    type_assert<AST::booleanType>(Grammar::visit(*this, exp.inner));
-    return AST::booleanType{};
-}
+    ThreadPool pool(threads);
+    if (pool.size() == 1) {
+        Grammar::visit(translator, p);
+        return;
+    }
 
-AST::Type TypeInferenceVisitor::operator()(AST::parenExp const& exp)
-{
-    return AST::Type{Grammar::visit(*this, exp.inner)};
+    // Shard 0 is main, then come the methods in source order
+    auto const& prog = Grammar::get<AST::ProgramRule>(p);
+    std::vector<std::pair<Symbol, AST::MethodDecl const*>> methods;
+    for (auto const& c : prog.classes)
+        Grammar::visit(
+            [&](auto const& cls) {
+                for (auto const& mtd : cls.methods)
+                    methods.push_back({cls.name, &mtd});
+            },
+            c);
+
+    std::vector<Tree> parts(methods.size() + 1);
+    pool.run(parts.size(), [&](size_t i) {
+        Translator part(parts[i], data, types);
+        if (i == 0)
+            Grammar::visit(part, prog.main);
+        else
+            part.method(methods[i - 1].first, *methods[i - 1].second);
+    });
+
+    t.append(parts[0]);
+    size_t next = 1;
+    for (auto const& c : prog.classes) {
+        auto const count = Grammar::visit(
+            [](auto const& cls) { return cls.methods.size(); }, c);
+        for (size_t i = 0; i < count; i++) t.append(parts[next++]);
+        if (Grammar::holds<AST::ClassDeclInheritance>(c))
+            translator.inherit(
+                Grammar::get<AST::ClassDeclInheritance>(c));
+    }
 }
 
 } // namespace IR
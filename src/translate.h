@@ -5,24 +5,32 @@
 #include "IR.h"
 #include "IRBuilder.h"
 #include "helper.h"
+#include "typecheck.h"
 
 namespace IR
 {
 struct fragmentGuard;
+
 class Translator
 {
-    friend struct TypeInferenceVisitor;
-    Tree&             t;
-    helper::meta_data data;
-    std::string       current_class;
-    std::string       current_method;
-    activation_record frame;
+    Tree&                    t;
+    helper::meta_data const& data;
+    TypeChecker const&       types;
+    Symbol                   current_class;
+    Symbol                   current_method;
+    activation_record        frame;
+    std::vector<int>         arguments;
 
     int binop(BinopId, AST::__detail::BinaryRule<AST::Exp> const&);
 
   public:
     Translator(Tree&);
-    Translator(Tree&, helper::meta_data&&);
+    Translator(Tree&, helper::meta_data const&, TypeChecker const&);
+
+    // A method of cls on its own, as the class declarations do
+    int method(Symbol cls, AST::MethodDecl const&);
+    // Files what cls inherits as aliases of the nearest definition
+    void inherit(AST::ClassDeclInheritance const& cls);
 
     int operator()(AST::andExp const& exp);
     int operator()(AST::sumExp const& exp);
@@ -58,48 +66,21 @@ class Translator
 
 struct fragmentGuard {
     Tree&             t;
-    std::string       label;
+    Symbol            label;
     activation_record rec;
 
-    fragmentGuard(Tree&, std::string, activation_record);
+    fragmentGuard(Tree&, Symbol, activation_record);
     ~fragmentGuard();
 };
 
-struct TypeError {
-    AST::Type expected;
-    AST::Type found;
-};
-
-template <typename T> void type_assert(AST::Type fnd)
-{
-    if (!Grammar::holds<T>(fnd)) throw TypeError{T{}, fnd};
-}
-
-struct TypeInferenceVisitor {
-    Translator& translator;
-
-    AST::Type operator()(AST::andExp const&);
-    AST::Type operator()(AST::lessExp const&);
-    AST::Type operator()(AST::sumExp const&);
-    AST::Type operator()(AST::minusExp const&);
-    AST::Type operator()(AST::prodExp const&);
-    AST::Type operator()(AST::indexingExp const&);
-    AST::Type operator()(AST::lengthExp const&);
-    AST::Type operator()(AST::methodCallExp const&);
-    AST::Type operator()(AST::integerExp const&);
-    AST::Type operator()(AST::trueExp const&);
-    AST::Type operator()(AST::falseExp const&);
-    AST::Type operator()(AST::thisExp const&);
-    AST::Type operator()(AST::identifierExp const&);
-    AST::Type operator()(AST::newArrayExp const&);
-    AST::Type operator()(AST::newObjectExp const&);
-    AST::Type operator()(AST::bangExp const&);
-    AST::Type operator()(AST::parenExp const&);
-};
-
 int  translate(Tree&, AST::Exp const&);
 int  translate(Tree&, AST::Stm const&);
-void translate(Tree&, AST::Program const&);
+// The semantic analysis and the translation can run on several
+// threads; zero means one per core. With more than one, every method
+// is translated into a tree of its own, so that its node, temp, label
+// and explist ids all start at 0, and the trees are appended in
+// source order, which gives the very tree a single thread builds.
+void translate(Tree&, AST::Program const&, unsigned threads = 1);
 } // namespace IR
 
 #endif
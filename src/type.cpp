@@ -0,0 +1,77 @@
+#include "type.h"
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace
+{
+// Entries up to TypeRef::none are the builtin kinds and have no name
+struct Interner {
+    std::shared_mutex                    lock;
+    std::deque<Symbol>                   names;
+    std::unordered_map<Symbol, uint32_t> ids;
+
+    Interner() : names(AST::TypeRef::none + 1) {}
+
+    uint32_t insert(Symbol cls)
+    {
+        names.push_back(cls);
+        return ids.emplace(cls, names.size() - 1).first->second;
+    }
+};
+
+Interner& table()
+{
+    static Interner interner;
+    return interner;
+}
+} // namespace
+
+namespace AST
+{
+uint32_t TypeRef::intern(Symbol cls)
+{
+    auto& t = table();
+    {
+        std::shared_lock<std::shared_mutex> read(t.lock);
+        auto                                it = t.ids.find(cls);
+        if (it != t.ids.end()) return it->second;
+    }
+    std::unique_lock<std::shared_mutex> write(t.lock);
+    auto                                it = t.ids.find(cls);
+    if (it != t.ids.end()) return it->second;
+    return t.insert(cls);
+}
+
+TypeRef::TypeRef(Type const& type)
+    : id(Grammar::visit([](auto const& t) { return TypeRef(t).id; },
+                        type))
+{
+}
+
+Symbol TypeRef::name() const
+{
+    if (id <= none) return {};
+    auto&                               t = table();
+    std::shared_lock<std::shared_mutex> read(t.lock);
+    return t.names[id];
+}
+
+std::ostream& operator<<(std::ostream& out, TypeRef t)
+{
+    switch (t.kind()) {
+    case TypeRef::integerArray:
+        return out << "int[]";
+    case TypeRef::boolean:
+        return out << "boolean";
+    case TypeRef::integer:
+        return out << "int";
+    case TypeRef::object:
+        return out << t.name();
+    case TypeRef::none:
+        break;
+    }
+    return out << "<none>";
+}
+} // namespace AST
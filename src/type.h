@@ -0,0 +1,68 @@
+#ifndef BCC_TYPE
+#define BCC_TYPE
+
+#include "AST.h"
+#include "symbol.h"
+#include <cstdint>
+
+namespace AST
+{
+// An interned type, the counterpart of Symbol for AST::Type. int[],
+// boolean and int are fixed entries of a process-wide table and each
+// class type is added the first time it is named, so a type is an
+// integer: copying one does not allocate and equal types have equal
+// handles. The default TypeRef is no type at all.
+class TypeRef
+{
+    uint32_t id;
+
+    explicit TypeRef(uint32_t i) : id(i) {}
+    static uint32_t intern(Symbol);
+
+  public:
+    // The kinds are in the same order as the alternatives of Type
+    enum kind_t : uint8_t {
+        integerArray,
+        boolean,
+        integer,
+        object,
+        none
+    };
+
+    TypeRef() : id(none) {}
+    TypeRef(integerArrayType const&) : id(integerArray) {}
+    TypeRef(booleanType const&) : id(boolean) {}
+    TypeRef(integerType const&) : id(integer) {}
+    TypeRef(classType const& cls) : id(intern(cls.value)) {}
+    TypeRef(Type const&);
+
+    uint32_t index() const { return id; }
+    kind_t   kind() const { return id <= none ? kind_t(id) : object; }
+    bool     empty() const { return id == none; }
+
+    // The class of an object type, and the empty symbol otherwise
+    Symbol name() const;
+
+    friend bool operator==(TypeRef a, TypeRef b)
+    {
+        return a.id == b.id;
+    }
+    friend bool operator!=(TypeRef a, TypeRef b)
+    {
+        return a.id != b.id;
+    }
+};
+
+std::ostream& operator<<(std::ostream&, TypeRef);
+} // namespace AST
+
+namespace std
+{
+template <> struct hash<AST::TypeRef> {
+    size_t operator()(AST::TypeRef t) const noexcept
+    {
+        return t.index();
+    }
+};
+} // namespace std
+#endif
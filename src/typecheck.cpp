@@ -0,0 +1,213 @@
+#include "typecheck.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <optional>
+
+namespace IR
+{
+namespace
+{
+using type_t = AST::TypeRef;
+using AST::TypeRef;
+
+// One step of the pass: the type of a node from the types of its
+// children, which fmap looks up by id. Statements and declarations
+// have no type, except for assignments.
+template <typename C> struct Infer {
+    C                        fmap;
+    helper::meta_data const& data;
+    Symbol                   cls;
+    Symbol                   mtd;
+
+    Infer(C&& __fmap, helper::meta_data const& _data)
+        : fmap(__fmap), data(_data)
+    {
+    }
+
+    template <typename nt_t> TypeRef of(nt_t const& child)
+    {
+        return fmap(AST::id(child));
+    }
+
+    void enter(AST::MainClassRule const& main)
+    {
+        cls = main.name;
+        mtd = "main";
+    }
+    void enter(AST::ClassDeclNoInheritance const& c) { cls = c.name; }
+    void enter(AST::ClassDeclInheritance const& c) { cls = c.name; }
+    void enter(AST::MethodDeclRule const& m) { mtd = m.name; }
+
+    // An object of a class will do wherever one of its base classes
+    // is expected
+    void accept(TypeRef expected, TypeRef found)
+    {
+        if (expected == found) return;
+        if (expected.kind() == TypeRef::object &&
+            found.kind() == TypeRef::object)
+            for (int b = data[found.name()].base; b != -1;
+                 b = data[b].base)
+                if (data[b].name == expected.name()) return;
+        throw TypeError{expected, found};
+    }
+
+    type_t binary(AST::__detail::BinaryRule<AST::Exp> const& exp,
+                  TypeRef operand, TypeRef ans)
+    {
+        type_assert(operand, of(exp.lhs));
+        type_assert(operand, of(exp.rhs));
+        return ans;
+    }
+
+    type_t operator()(AST::andExp const& exp)
+    {
+        return binary(exp, AST::booleanType{}, AST::booleanType{});
+    }
+    type_t operator()(AST::lessExp const& exp)
+    {
+        return binary(exp, AST::integerType{}, AST::booleanType{});
+    }
+    type_t operator()(AST::sumExp const& exp)
+    {
+        return binary(exp, AST::integerType{}, AST::integerType{});
+    }
+    type_t operator()(AST::minusExp const& exp)
+    {
+        return binary(exp, AST::integerType{}, AST::integerType{});
+    }
+    type_t operator()(AST::prodExp const& exp)
+    {
+        return binary(exp, AST::integerType{}, AST::integerType{});
+    }
+
+    type_t operator()(AST::indexingExp const& exp)
+    {
+        type_assert(AST::integerArrayType{}, of(exp.lhs));
+        type_assert(AST::integerType{}, of(exp.rhs));
+        return AST::integerType{};
+    }
+
+    type_t operator()(AST::lengthExp const& exp)
+    {
+        type_assert(AST::integerArrayType{}, of(exp.inner));
+        return AST::integerType{};
+    }
+
+    type_t operator()(AST::methodCallExp const& exp)
+    {
+        auto const& cls  = data[of(exp.object).name()];
+        auto const& spec = cls.method(exp.name);
+        auto const& es =
+            Grammar::get<AST::ExpListRule>(exp.arguments).exps;
+        if (es.size() != spec.arglist.size())
+            throw ArityError{cls.name, exp.name, spec.arglist.size(),
+                             es.size()};
+        for (size_t i = 0; i < es.size(); i++)
+            accept(spec.arglist[i].type, of(es[i]));
+        return spec.return_type;
+    }
+
+    type_t operator()(AST::integerExp const&)
+    {
+        return AST::integerType{};
+    }
+    type_t operator()(AST::trueExp const&)
+    {
+        return AST::booleanType{};
+    }
+    type_t operator()(AST::falseExp const&)
+    {
+        return AST::booleanType{};
+    }
+    type_t operator()(AST::thisExp const&)
+    {
+        return AST::classType{cls};
+    }
+
+    type_t operator()(AST::identifierExp const& exp)
+    {
+        return TypeChecker::lookup(data, cls, mtd, exp.value);
+    }
+
+    type_t operator()(AST::newArrayExp const& exp)
+    {
+        type_assert(AST::integerType{}, of(exp.inner));
+        return AST::integerArrayType{};
+    }
+
+    type_t operator()(AST::newObjectExp const& exp)
+    {
+        return AST::classType{exp.value};
+    }
+
+    type_t operator()(AST::bangExp const& exp)
+    {
+        type_assert(AST::booleanType{}, of(exp.inner));
+        return AST::booleanType{};
+    }
+
+    type_t operator()(AST::parenExp const& exp)
+    {
+        return of(exp.inner);
+    }
+
+    type_t operator()(AST::assignStm const& stm)
+    {
+        auto lhs = TypeChecker::lookup(data, cls, mtd, stm.name);
+        accept(lhs, of(stm.value));
+        return lhs;
+    }
+
+    template <typename T> type_t operator()(T const&)
+    {
+        return {};
+    }
+};
+} // namespace
+
+TypeChecker::TypeChecker() {}
+
+// Classes are checked one by one, each on whichever thread is free.
+// The nodes of a class have the ids right after its own, so each
+// class gets its own stretch of the table.
+TypeChecker::TypeChecker(helper::meta_data const& data,
+                         AST::Program const& prog, unsigned threads)
+{
+    using walk_t      = AST::Catamorphism<Infer, type_t>;
+    auto const& rule  = Grammar::get<AST::ProgramRule>(prog);
+    auto        check = [&](auto const& root) {
+        walk_t walk(AST::from_id{AST::id(root)}, root, data);
+        return std::make_pair(walk.base, std::move(walk.x));
+    };
+
+    std::vector<std::pair<int, std::vector<type_t>>> parts(
+        rule.classes.size() + 1);
+    ThreadPool pool(threads);
+    pool.run(parts.size(), [&](size_t k) {
+        parts[k] = k == 0 ? check(rule.main)
+                          : check(rule.classes[k - 1]);
+    });
+
+    size_t size = 0;
+    for (auto const& [base, part] : parts)
+        size = std::max(size, base + part.size());
+    types.resize(size);
+    for (auto const& [base, part] : parts)
+        std::copy(begin(part), end(part), begin(types) + base);
+}
+
+TypeRef TypeChecker::operator[](int id) const
+{
+    auto type = types.at(id);
+    if (type.empty()) throw std::bad_optional_access();
+    return type;
+}
+
+TypeRef TypeChecker::lookup(helper::meta_data const& data, Symbol cls,
+                            Symbol mtd, Symbol name)
+{
+    auto const var = data[cls].resolve(mtd, name);
+    if (var.where == helper::binding::notfound) throw;
+    return var.type;
+}
+} // namespace IR
@@ -0,0 +1,58 @@
+#ifndef BCC_TYPECHECK
+#define BCC_TYPECHECK
+
+#include "AST.h"
+#include "ASTCatamorphism.h"
+#include "helper.h"
+#include "type.h"
+#include <vector>
+
+namespace IR
+{
+struct TypeError {
+    AST::TypeRef expected;
+    AST::TypeRef found;
+};
+
+// A method called with too many or too few arguments
+struct ArityError {
+    Symbol cls;
+    Symbol method;
+    size_t expected;
+    size_t found;
+};
+
+inline void type_assert(AST::TypeRef exp, AST::TypeRef fnd)
+{
+    if (exp != fnd) throw TypeError{exp, fnd};
+}
+
+// The type of every expression in a program, worked out once, in a
+// single bottom-up pass, and kept by node id. An assignment is also
+// given the type of the variable it assigns to. Nodes without a type
+// get the empty TypeRef. Classes are checked concurrently on as many
+// threads as asked for; if several are wrong, the error reported is
+// the one of the first, as it would be on a single thread.
+class TypeChecker
+{
+    std::vector<AST::TypeRef> types;
+
+  public:
+    TypeChecker();
+    TypeChecker(helper::meta_data const&, AST::Program const&,
+                unsigned threads = 1);
+
+    AST::TypeRef operator[](int id) const;
+    template <typename nt_t>
+    AST::TypeRef operator[](nt_t const& exp) const
+    {
+        return (*this)[AST::id(exp)];
+    }
+
+    // The declared type of a name, as seen from inside a method
+    static AST::TypeRef lookup(helper::meta_data const&, Symbol cls,
+                               Symbol mtd, Symbol name);
+};
+} // namespace IR
+
+#endif
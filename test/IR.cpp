@@ -163,6 +163,8 @@ TEST_F(IRBuilderTest, treeKeepsType)
     EXPECT_NE(tree.get_type(n), IR::IRTag::CONST);
 }
 
+// Only debug builds check the tag
+#ifndef NDEBUG
 TEST_F(IRBuilderTest, wrongGetNameThrows)
 {
     IRBuilder builder(tree);
@@ -178,6 +180,91 @@ TEST_F(IRBuilderTest, stmAccessedAsExpThrows)
     auto stm = builder.build();
     EXPECT_THROW(tree.get_const(stm), IR::BadAccess);
 }
+#endif
+
+TEST_F(IRBuilderTest, visitHandsOverTheTaggedNode)
+{
+    IRBuilder cte(tree);
+    cte << IR::IRTag::CONST << 42;
+    auto c = cte.build();
+
+    IRBuilder mem(tree);
+    mem << IR::IRTag::MEM << c;
+    auto m = mem.build();
+
+    auto inner = Util::type_switch{
+        [](IR::Const const& k) { return k.value; },
+        [](IR::Mem const& at) { return -at.exp; },
+        [](auto const&) { return 0; }};
+    EXPECT_EQ(tree.visit(c, inner), 42);
+    EXPECT_EQ(tree.visit(m, inner), -c);
+
+    tree.visit(c, [](auto& node) {
+        if constexpr (std::is_same_v<decltype(node), IR::Const&>)
+            node.value = 7;
+    });
+    EXPECT_EQ(tree.get_const(c).value, 7);
+}
+
+TEST_F(IRBuilderTest, singleFieldNodesStayInline)
+{
+    IRBuilder cte(tree);
+    cte << IR::IRTag::CONST << 42;
+    auto c = cte.build();
+    auto t = tree.new_temp();
+
+    IRBuilder sum(tree);
+    sum << IR::IRTag::BINOP << IR::PLUS << t << c;
+    auto b = sum.build();
+
+    EXPECT_EQ(tree.get_temp(t).id, 0);
+    EXPECT_EQ(tree.get_binop(b).rhs, c);
+    EXPECT_LT(tree.bytes(), 3 * 8 + sizeof(IR::Binop));
+}
+
+TEST_F(IRBuilderTest, explistBuildersNest)
+{
+    ExplistBuilder outer(tree);
+    outer << 1;
+    int inner = [&] {
+        ExplistBuilder args(tree);
+        args << 2 << 3;
+        return args.build();
+    }();
+    outer << 4;
+    int list = outer.build();
+
+    EXPECT_EQ(std::vector<int>(tree.get_explist(inner).begin(),
+                               tree.get_explist(inner).end()),
+              (std::vector<int>{2, 3}));
+    auto const es = tree.get_explist(list);
+    ASSERT_EQ(es.size(), 2u);
+    EXPECT_EQ(es[0], 1);
+    EXPECT_EQ(es[1], 4);
+}
+
+TEST(fragmentTableTest, fragmentsComeInSpellingOrder)
+{
+    // Interned the other way round, so the ids disagree
+    Symbol const second("fragmentTableZ");
+    Symbol const first("fragmentTableA");
+
+    IR::fragment_table table;
+    table[second].stms = {2};
+    table[first].stms  = {1};
+    EXPECT_FALSE(table.insert({first, table.at(second)}).second);
+
+    ASSERT_EQ(table.size(), 2u);
+    EXPECT_EQ(table.begin()->first, first);
+    EXPECT_EQ(table.at(first).stms, std::vector<int>{1});
+    EXPECT_EQ(table.at(second).stms, std::vector<int>{2});
+    EXPECT_EQ(table.count(Symbol("fragmentTableMissing")), 0u);
+
+    table.erase(table.find(first));
+    EXPECT_EQ(table.count(first), 0u);
+    EXPECT_EQ(table.begin()->first, second);
+    EXPECT_EQ(table.at(second).stms, std::vector<int>{2});
+}
 
 int main(int argc, char** argv)
 {
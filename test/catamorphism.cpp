@@ -1,6 +1,9 @@
+#include "ASTCatamorphism.h"
 #include "IR.h"
 #include "IRBuilder.h"
+#include "parser.h"
 #include "gtest/gtest.h"
+#include <sstream>
 
 #pragma GCC diagnostic ignored "-Wunused-parameter"
 #pragma GCC diagnostic push
@@ -56,6 +59,190 @@ TEST_F(catamorphismTest, CataForwardsArguments)
     }
 }
 
+template <typename C> struct Visits {
+    int operator()(const IR::Binop& binop)
+    {
+        seen++;
+        return fmap(binop.lhs) + fmap(binop.rhs);
+    }
+    template <typename T> int operator()(const T& t)
+    {
+        seen++;
+        return 1;
+    }
+
+    Visits(C&& __fmap, int& _seen) : fmap(__fmap), seen(_seen) {}
+    C    fmap;
+    int& seen;
+};
+
+TEST_F(catamorphismTest, onDemandOnlyVisitsWhatIsAsked)
+{
+    int                           eager = 0, lazy = 0;
+    IR::Catamorphism<Visits, int> F(tree, std::ref(eager));
+    IR::Catamorphism<Visits, int> G(IR::on_demand{}, tree,
+                                    std::ref(lazy));
+    EXPECT_EQ(eager, tree.size());
+    EXPECT_EQ(lazy, 0);
+
+    int const inner = tree.get_binop(root).lhs;
+    EXPECT_EQ(G(inner), F(inner));
+    EXPECT_EQ(lazy, tree.size() - 2);
+    EXPECT_EQ(G(root), F(root));
+    EXPECT_EQ(G(root), 11);
+    EXPECT_EQ(lazy, tree.size());
+}
+
+template <typename C> struct Total {
+    int operator()(const IR::Binop& binop)
+    {
+        seen++;
+        return fmap(binop.lhs) + fmap(binop.rhs);
+    }
+    int operator()(const IR::Const& c)
+    {
+        seen++;
+        return c.value;
+    }
+    template <typename T> int operator()(const T& t) { return 0; }
+
+    Total(C&& __fmap, int& _seen) : fmap(__fmap), seen(_seen) {}
+    C    fmap;
+    int& seen;
+};
+
+TEST_F(catamorphismTest, incrementalOnlyRedoesWhatChanged)
+{
+    int                          seen = 0;
+    IR::Catamorphism<Total, int> F(IR::incremental{}, tree,
+                                   std::ref(seen));
+    EXPECT_EQ(F(root), 45);
+    EXPECT_EQ(seen, tree.size());
+
+    IRBuilder cte(tree), sum(tree);
+    cte << IR::IRTag::CONST << 100;
+    sum << IR::IRTag::BINOP << IR::BinopId::PLUS << root
+        << cte.build();
+    int const top = sum.build();
+
+    seen = 0;
+    F.update();
+    EXPECT_EQ(seen, 2);
+    EXPECT_EQ(F(top), 145);
+
+    // The constant 9 is the right operand of root; only root and top
+    // are above it
+    int const nine = tree.get_binop(root).rhs;
+    tree.get_const(nine).value = 19;
+    F.invalidate(nine);
+    seen = 0;
+    F.update();
+    EXPECT_EQ(seen, 3);
+    EXPECT_EQ(F(root), 55);
+    EXPECT_EQ(F(top), 155);
+
+    // Once root no longer has the 9 as an operand, changing the 9
+    // leaves root alone
+    IRBuilder two(tree);
+    two << IR::IRTag::CONST << 2;
+    tree.get_binop(root).rhs = two.build();
+    F.invalidate(root);
+    seen = 0;
+    F.update();
+    EXPECT_EQ(seen, 3);
+    EXPECT_EQ(F(top), 138);
+
+    F.invalidate(nine);
+    seen = 0;
+    F.update();
+    EXPECT_EQ(seen, 1);
+
+    // root now uses a newer node, which the id sweep would read
+    // before working it out
+    int                          fresh = 0;
+    IR::Catamorphism<Total, int> G(IR::on_demand{}, tree,
+                                   std::ref(fresh));
+    for (size_t i = 0; i < tree.size(); i++) EXPECT_EQ(F(i), G(i));
+}
+
+TEST_F(catamorphismTest, levelsGoByHeight)
+{
+    auto const level = IR::by_height(tree);
+    ASSERT_EQ(level.first.size(), 12);
+    EXPECT_EQ(level.first[1], 11);
+    for (int k = 1; k <= 10; k++)
+        EXPECT_EQ(level.first[k + 1] - level.first[k], 1);
+    EXPECT_EQ(level.nodes.back(), root);
+}
+
+TEST_F(catamorphismTest, parallelGivesWhatTheSweepGives)
+{
+    // A MEM over a newer node, the way spill leaves temps
+    IRBuilder mem(tree), cte(tree), sum(tree);
+    mem << IR::IRTag::MEM << int(tree.size()) + 2;
+    int const spilled = mem.build();
+    cte << IR::IRTag::CONST << 8;
+    sum << IR::IRTag::BINOP << IR::BinopId::PLUS << root
+        << cte.build();
+    sum.build();
+
+    IR::Catamorphism<IR::DeepFormat, std::string> F(tree);
+    IR::Catamorphism<IR::DeepFormat, std::string> G(
+        IR::in_parallel{4}, tree);
+    for (size_t i = 0; i < tree.size(); i++) EXPECT_EQ(F(i), G(i));
+    EXPECT_EQ(G(spilled), "MEM{}");
+}
+
+// Size of every subtree, and the order nodes were seen in
+template <typename C> struct SubtreeSize {
+    template <typename T> int operator()(const T& node)
+    {
+        seen.push_back(node.id);
+        int ans = 1;
+        AST::children(node, [&](auto const& nt) {
+            ans += fmap(AST::id(nt));
+        });
+        return ans;
+    }
+
+    SubtreeSize(C&& __fmap, std::vector<int>& _seen)
+        : fmap(__fmap), seen(_seen)
+    {
+    }
+    C                 fmap;
+    std::vector<int>& seen;
+};
+
+TEST(astCatamorphismTest, childrenComeFirst)
+{
+    auto stream = std::stringstream("a.f(1 + 2, !b) * (c < d)");
+    auto parser = Parser(&stream);
+    auto root   = parser.Exp();
+
+    std::vector<int>                    seen;
+    AST::Catamorphism<SubtreeSize, int> F(root, seen);
+    // call, object, list, sum, 1, 2, bang, b, paren, less, c, d, prod
+    EXPECT_EQ(F(AST::id(root)), 13);
+    EXPECT_EQ(seen.size(), 13u);
+    EXPECT_EQ(seen.back(), AST::id(root));
+
+    auto const& prod = Grammar::get<AST::prodExp>(root);
+    EXPECT_EQ(F(AST::id(prod.lhs)), 8);
+    EXPECT_EQ(F(AST::id(prod.rhs)), 4);
+}
+
+TEST(astCatamorphismTest, deepTreesDoNotRecurse)
+{
+    std::string text = "x";
+    for (int i = 1; i < 100000; i++) text += " - x";
+    Parser parser("chain", std::string_view(text));
+    auto   root = parser.Exp();
+
+    std::vector<int>                    seen;
+    AST::Catamorphism<SubtreeSize, int> F(root, seen);
+    EXPECT_EQ(F(AST::id(root)), 2 * 100000 - 1);
+}
+
 int main(int argc, char** argv)
 {
     ::testing::InitGoogleTest(&argc, argv);
@@ -58,6 +58,16 @@ TEST_F(HelperTest, MetaDataHandlesInheritance)
               data["Child"].method("ComputeFac").layout["not_aux"]);
 }
 
+TEST_F(HelperTest, MetaDataSharesInheritedMethods)
+{
+    auto const& spec = data["Child"].method("ComputeFac");
+    EXPECT_EQ(&spec, &data["Fac"].method("ComputeFac"));
+    EXPECT_EQ(spec.owner().name, std::string("Fac"));
+
+    helper::meta_data moved(std::move(data));
+    EXPECT_EQ(&moved["Child"].method("ComputeFac"), &spec);
+}
+
 TEST_F(HelperTest, MetaDataKeepsNames)
 {
     EXPECT_EQ(data["Child"].name, std::string("Child"));
@@ -95,6 +105,69 @@ TEST_F(HelperTest, MetaDataHandlesDeeperInheritsLayout)
     EXPECT_EQ(data["A"].variable["t4"], 24);
 }
 
+TEST_F(HelperTest, MetaDataResolvesNamesInOneLookup)
+{
+    TranslationUnit unordered("../input/unordered_classes.miniJava");
+    EXPECT_TRUE(unordered.check());
+    data = helper::meta_data(unordered.syntax_tree);
+
+    auto const arg = data["Fac"].resolve("ComputeFac", "num");
+    EXPECT_EQ(arg.where, helper::binding::argument);
+    EXPECT_EQ(arg.offset, 0);
+
+    auto const local = data["Fac"].resolve("ComputeFac", "num_aux");
+    EXPECT_EQ(local.where, helper::binding::local);
+    EXPECT_EQ(local.type, AST::TypeRef(AST::integerType{}));
+
+    auto const field = data["Fac"].resolve("Compute", "input");
+    EXPECT_EQ(field.where, helper::binding::field);
+    EXPECT_EQ(field.type.name(), "IntegerWrapper");
+
+    auto const own = data["A"].resolve("calculateA", "t4");
+    EXPECT_EQ(own.where, helper::binding::field);
+    EXPECT_EQ(own.offset, 24);
+    EXPECT_EQ(data["A"]["t4"], helper::kind_t::var);
+
+    EXPECT_EQ(data["A"].resolve("calculateA", "x").where,
+              helper::binding::notfound);
+}
+
+TEST_F(HelperTest, MetaDataIsTheSameOnAnyNumberOfThreads)
+{
+    TranslationUnit unordered("../input/unordered_classes.miniJava");
+    EXPECT_TRUE(unordered.check());
+    helper::meta_data serial(unordered.syntax_tree, 1);
+    helper::meta_data parallel(unordered.syntax_tree, 4);
+
+    for (auto cls : {"Factorial", "Fac", "IntegerWrapper", "A", "B",
+                     "C", "D", "E", "F"}) {
+        EXPECT_EQ(serial[cls].size(), parallel[cls].size());
+        EXPECT_EQ(serial[cls].base, parallel[cls].base);
+        EXPECT_EQ(serial[cls].methods, parallel[cls].methods);
+    }
+    EXPECT_EQ(parallel["A"].variable["t4"], 24);
+    EXPECT_EQ(parallel["A"]["calculate"], helper::kind_t::method_inh);
+}
+
+TEST_F(HelperTest, MetaDataKnowsEveryClassInLocals)
+{
+    std::string text = "class Main {\n"
+                       "  public static void main(String[] a) {\n"
+                       "    System.out.println(new B().f());\n"
+                       "  }\n"
+                       "}\n"
+                       "class A { int x; int y; }\n"
+                       "class B {\n"
+                       "  public int f() { A a; int n; return 1; }\n"
+                       "}\n";
+    Parser parser("locals", std::string_view(text));
+    auto   prog = parser.Program();
+    ASSERT_FALSE(parser.errors.has_errors());
+
+    data = helper::meta_data(prog);
+    EXPECT_EQ(data["B"].method("f").layout["n"], 16);
+}
+
 TEST_F(HelperTest, MetaDataHandlesDeeperInheritanceMethods)
 {
     TranslationUnit unordered("../input/unordered_classes.miniJava");
@@ -111,6 +184,8 @@ TEST_F(HelperTest, MetaDataHandlesDeeperInheritanceMethods)
               data["C"].method("calculate").layout["num_aux"]);
     EXPECT_EQ(data["A"].method("calculate").layout["not_aux"],
               data["C"].method("calculate").layout["not_aux"]);
+    EXPECT_EQ(&data["A"].method("calculate"),
+              &data["C"].method("calculate"));
 }
 
 TEST_F(HelperTest, MetaDataDetectsCyclicDepdendencies)
@@ -119,6 +194,37 @@ TEST_F(HelperTest, MetaDataDetectsCyclicDepdendencies)
     EXPECT_TRUE(cycle.check());
     EXPECT_THROW(helper::meta_data(cycle.syntax_tree),
                  helper::cyclic_classes);
+    try {
+        helper::meta_data data(cycle.syntax_tree);
+    } catch (helper::cyclic_classes const& err) {
+        ASSERT_EQ(err.cycles.size(), 1);
+        std::vector<Symbol> const abc{"A", "B", "C"};
+        EXPECT_EQ(err.cycles[0], abc);
+    }
+}
+
+TEST(ClassGraphTest, LongChainsDoNotRecurse)
+{
+    int const   depth = 200000;
+    std::string text  = "class Main {\n"
+                       "  public static void main(String[] a) {\n"
+                       "    System.out.println(1);\n"
+                       "  }\n"
+                       "}\n"
+                       "class C0 { int x; }\n";
+    for (int i = 1; i < depth; i++)
+        text += "class C" + std::to_string(i) + " { C" +
+                std::to_string(i - 1) + " inner; }\n";
+    Parser parser("chain", std::string_view(text));
+    auto   prog = parser.Program();
+    ASSERT_FALSE(parser.errors.has_errors());
+
+    helper::class_graph order(Grammar::get<AST::ProgramRule>(prog));
+    ASSERT_EQ(order.ans.size(), depth + 1);
+    std::vector<int> place(depth + 1);
+    for (int k = 0; k <= depth; k++) place[order.ans[k]] = k;
+    for (int i = 2; i <= depth; i++)
+        EXPECT_LT(place[i - 1], place[i]);
 }
 
 TEST_F(HelperTest, MetaDataStoresStackLayout)
@@ -132,25 +238,35 @@ TEST_F(HelperTest, MetaDataStoresFormalList)
     EXPECT_EQ(data["Fac"].method("ComputeFac").arglist.size(), 1);
     auto const& [type, name] =
         data["Fac"].method("ComputeFac").arglist[0];
-    EXPECT_TRUE(Grammar::holds<AST::integerType>(type));
+    EXPECT_EQ(type, AST::TypeRef(AST::integerType{}));
     EXPECT_EQ(name, std::string("num"));
 }
 
 TEST_F(HelperTest, MetaDataStoresReturnType)
 {
-    EXPECT_TRUE(Grammar::holds<AST::integerType>(
-        data["Fac"].method("ComputeFac").return_type));
+    EXPECT_EQ(data["Fac"].method("ComputeFac").return_type,
+              AST::TypeRef(AST::integerType{}));
     TranslationUnit sample4("../input/sample4.miniJava");
     EXPECT_TRUE(sample4.check());
     data = helper::meta_data(sample4.syntax_tree);
-    EXPECT_EQ(Grammar::get<AST::classType>(
-                  data["Fac"].method("increase").return_type)
-                  .value,
-              std::string("Fac"));
-    EXPECT_EQ(Grammar::get<AST::classType>(
-                  data["Fac"].method("ComputeFac").return_type)
-                  .value,
+    EXPECT_EQ(data["Fac"].method("increase").return_type.name(),
               std::string("Fac"));
+    EXPECT_EQ(data["Fac"].method("ComputeFac").return_type,
+              data["Fac"].method("increase").return_type);
+}
+
+TEST(TypeRefTest, EqualTypesShareOneEntry)
+{
+    AST::TypeRef foo = AST::classType(Symbol("Foo"));
+    AST::TypeRef bar = AST::classType(Symbol("Bar"));
+    EXPECT_EQ(foo, AST::TypeRef(AST::classType(Symbol("Foo"))));
+    EXPECT_NE(foo, bar);
+    EXPECT_EQ(foo.kind(), bar.kind());
+    EXPECT_EQ(bar.name(), "Bar");
+    EXPECT_NE(AST::TypeRef(AST::integerType{}),
+              AST::TypeRef(AST::integerArrayType{}));
+    EXPECT_TRUE(AST::TypeRef().empty());
+    EXPECT_TRUE(AST::TypeRef(AST::booleanType{}).name().empty());
 }
 
 TEST_F(HelperTest, HelperMangles)
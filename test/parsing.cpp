@@ -2,6 +2,7 @@
 #include "parser.h"
 #include "translate.h"
 #include "gtest/gtest.h"
+#include <fstream>
 #include <sstream>
 
 #pragma GCC diagnostic ignored "-Wunused-parameter"
@@ -35,6 +36,224 @@ TEST(parsingTest, stringParsing)
     EXPECT_TRUE(rep);
 }
 
+TEST(parsingTest, errorsSpellContextWhenPrinted)
+{
+    std::string text = "class Main {\n"
+                       "  public static void main(String[] a) {\n"
+                       "    x = ;\n"
+                       "  }\n"
+                       "}\n";
+    Parser parser("bad", std::string_view(text));
+    auto   root = parser.Program();
+    EXPECT_TRUE(parser.errors.has_errors());
+
+    std::stringstream out;
+    Reporter          rep(out, parser.errors);
+    Grammar::visit(rep, root);
+    EXPECT_FALSE(rep);
+    EXPECT_NE(out.str().find("bad:"), std::string::npos);
+    EXPECT_NE(out.str().find("Main Class"), std::string::npos);
+    EXPECT_NE(out.str().find("Statement"), std::string::npos);
+    EXPECT_NE(out.str().find("Expression"), std::string::npos);
+}
+
+TEST(parsingTest, copiedTypesOutliveTheOriginal)
+{
+    auto stream = std::stringstream("Foo Bar");
+    auto parser = Parser(&stream);
+    auto copy   = std::make_unique<AST::Type>(parser.Type());
+    AST::Type type(*copy);
+    copy.reset();
+
+    // The node stays in the parser's arena until the parser goes
+    AST::Type other = parser.Type();
+    ASSERT_TRUE(Grammar::holds<AST::classType>(type));
+    EXPECT_EQ(Grammar::get<AST::classType>(type).value, "Foo");
+    EXPECT_EQ(Grammar::get<AST::classType>(other).value, "Bar");
+}
+
+TEST(parsingTest, expressionsFollowPrecedence)
+{
+    auto stream =
+        std::stringstream("1 + 2 * 3 < 4 - 5 - 6 && !x.lenght");
+    auto parser = Parser(&stream);
+    auto root   = parser.Exp();
+
+    auto const& conj = Grammar::get<AST::andExp>(root);
+    auto const& less = Grammar::get<AST::lessExp>(conj.lhs);
+    auto const& sum  = Grammar::get<AST::sumExp>(less.lhs);
+    EXPECT_TRUE(Grammar::holds<AST::integerExp>(sum.lhs));
+    EXPECT_TRUE(Grammar::holds<AST::prodExp>(sum.rhs));
+    auto const& diff = Grammar::get<AST::minusExp>(less.rhs);
+    EXPECT_TRUE(Grammar::holds<AST::minusExp>(diff.lhs));
+    EXPECT_EQ(Grammar::get<AST::integerExp>(diff.rhs).value, 6);
+    auto const& bang = Grammar::get<AST::bangExp>(conj.rhs);
+    EXPECT_TRUE(Grammar::holds<AST::lengthExp>(bang.inner));
+}
+
+TEST(parsingTest, longChainsDoNotRecurse)
+{
+    int const   terms = 100000;
+    std::string text  = "x";
+    for (int i = 1; i < terms; i++) text += " + x";
+    Parser parser("chain", std::string_view(text));
+    auto   root = parser.Exp();
+
+    EXPECT_FALSE(parser.errors.has_errors());
+    AST::Exp const* node  = &root;
+    int             depth = 1;
+    while (Grammar::holds<AST::sumExp>(*node)) {
+        EXPECT_TRUE(Grammar::holds<AST::identifierExp>(
+            Grammar::get<AST::sumExp>(*node).rhs));
+        node = &Grammar::get<AST::sumExp>(*node).lhs;
+        depth++;
+    }
+    EXPECT_EQ(depth, terms);
+}
+
+TEST(parsingTest, lexerTokensViewSource)
+{
+    std::string text("class Foo {\n// }\n  42 }");
+    Lexer       lexer(text, 2);
+
+    EXPECT_EQ(Lexeme(*lexer), Lexeme::class_keyword);
+    EXPECT_EQ(Lexeme(lexer[1]), Lexeme::identifier);
+    ++lexer;
+    EXPECT_EQ((*lexer).second, "Foo");
+    EXPECT_EQ((*lexer).second.data(), text.data() + 6);
+    ++lexer;
+    ++lexer;
+    EXPECT_EQ(Lexeme(*lexer), Lexeme::integer_literal);
+    EXPECT_EQ((*lexer).second, "42");
+    EXPECT_EQ(lexer.line_count(), 3);
+    ++lexer;
+    ++lexer;
+    EXPECT_TRUE(lexer.empty());
+}
+
+TEST(parsingTest, lexerInternsIdentifiers)
+{
+    std::string text("Foo bar class Foo");
+    Lexer       lexer(text, 4);
+
+    EXPECT_EQ(lexer[0].fourth, lexer[3].fourth);
+    EXPECT_NE(lexer[0].fourth, lexer[1].fourth);
+    EXPECT_TRUE(lexer[2].fourth.empty());
+    EXPECT_EQ(lexer[0].fourth, Symbol("Foo"));
+    EXPECT_EQ(lexer[1].fourth.str(), "bar");
+    EXPECT_TRUE(Symbol("bar") == "bar");
+    EXPECT_EQ(Symbol(std::string("bar")).index(),
+              lexer[1].fourth.index());
+}
+
+TEST(parsingTest, tokenBufferMatchesLexer)
+{
+    Source      source("../input/sample.miniJava");
+    TokenBuffer buffer(source.view());
+    Lexer       lexer(source.view());
+
+    size_t i = 0;
+    for (;; ++lexer, i++) {
+        ASSERT_LT(i, buffer.size());
+        EXPECT_EQ(buffer.kind[i], Lexeme(*lexer));
+        EXPECT_EQ(buffer[i].second, (*lexer).second);
+        EXPECT_EQ(buffer[i].third, (*lexer).third);
+        EXPECT_EQ(buffer[i].fourth, (*lexer).fourth);
+        if (lexer.empty()) break;
+    }
+    EXPECT_EQ(i + 1, buffer.size());
+
+    TokenCursor cursor(buffer);
+    EXPECT_EQ(cursor.kind(), Lexeme::class_keyword);
+    EXPECT_EQ(cursor.kind(buffer.size() + 5), Lexeme::eof);
+}
+
+TEST(parsingTest, parallelTokenBufferMatchesSerial)
+{
+    std::string text;
+    for (int i = 0; i < 500; i++)
+        text += "fresh" + std::to_string(i % 97) + " = x; // {\n\n";
+    // Punctuation the lexer does not know gets no symbol either way
+    text += "x / y;\n";
+
+    // Lexed in pieces first, so the pieces intern the symbols
+    TokenBuffer parallel(text, 7);
+    TokenBuffer serial(text, 1);
+
+    ASSERT_EQ(parallel.size(), serial.size());
+    EXPECT_EQ(parallel.kind, serial.kind);
+    EXPECT_EQ(parallel.offset, serial.offset);
+    EXPECT_EQ(parallel.length, serial.length);
+    EXPECT_EQ(parallel.line, serial.line);
+    EXPECT_EQ(parallel.symbol, serial.symbol);
+    for (int i = 0; i + 1 < 97; i++)
+        EXPECT_LT(Symbol("fresh" + std::to_string(i)),
+                  Symbol("fresh" + std::to_string(i + 1)));
+}
+
+TEST(parsingTest, tokenBufferRejectsHugeSources)
+{
+    // Too long to index with 32 bits; refused before it is read
+    char const             text = '\n';
+    std::string_view const huge(&text, size_t(UINT32_MAX) + 1);
+    EXPECT_THROW(TokenBuffer(huge, 1), std::length_error);
+}
+
+TEST(parsingTest, keywordsAreMatchedExactly)
+{
+    for (size_t i = 0; i < reserved_words.size(); i++)
+        EXPECT_EQ(Keywords::classify(reserved_words[i]), Lexeme(i + 2));
+    for (auto w : {"i", "in", "ints", "whilst", "Strings", "string",
+                   "thi", "/", "&", "System.out.print", "lenghts"})
+        EXPECT_EQ(Keywords::classify(w), Lexeme::identifier);
+}
+
+TEST(parsingTest, spansAgreeAcrossIsas)
+{
+    // Runs that cross the 16 and 32 byte blocks and end at the tail
+    std::string text;
+    for (int i = 0; i < 70; i++)
+        text += std::string(i, " \t\n"[i % 3]) + "ab_c9" +
+                std::string(i % 40, 'x') + "+0123456789" +
+                std::string(i, '7') + "\n";
+
+    using Scan::Isa;
+    for (auto cls : {Scan::space, Scan::digit, Scan::word, Scan::line})
+        for (size_t lo = 0; lo <= text.size(); lo++) {
+            size_t hi = Scan::span(Isa::scalar, cls, text, lo);
+            if (Scan::best() != Isa::scalar) {
+                EXPECT_EQ(Scan::span(Isa::sse2, cls, text, lo), hi);
+            }
+            if (Scan::best() == Isa::avx2) {
+                EXPECT_EQ(Scan::span(Isa::avx2, cls, text, lo), hi);
+            }
+        }
+}
+
+TEST(parsingTest, lexerCountsLinesInWhitespaceRuns)
+{
+    std::string text("a\n\n  \t\n b // c\n\n");
+    text += std::string(40, ' ') + "\n\nd\n\n";
+    Lexer lexer(text);
+    EXPECT_EQ(lexer.line_count(), 1);
+    ++lexer;
+    EXPECT_EQ(lexer.line_count(), 4);
+    ++lexer;
+    EXPECT_EQ(lexer.line_count(), 8);
+    ++lexer;
+    EXPECT_TRUE(lexer.empty());
+    EXPECT_EQ(lexer.line_count(), 9);
+}
+
+TEST(parsingTest, mappedSourceMatchesStream)
+{
+    Source        mapped("../input/sample.miniJava");
+    std::ifstream stream("../input/sample.miniJava");
+    Source        read(&stream);
+    EXPECT_NE(mapped.view().size(), 0);
+    EXPECT_EQ(mapped.view(), read.view());
+}
+
 TEST(parsingTest, bad)
 {
     TranslationUnit tu("../input/bad.miniJava");
@@ -182,10 +182,11 @@ TEST(translatorTest, translatesFullSample)
     EXPECT_EQ(tree.methods.size(), 2);
 
     std::set<std::string> frags = {
-        std::string("main"), helper::mangle("Fac", "ComputeFac")};
+        std::string("main"),
+        helper::mangle("Fac", "ComputeFac").str()};
 
     for (auto it : tree.methods) {
-        auto f = frags.find(it.first);
+        auto f = frags.find(it.first.str());
         EXPECT_NE(f, frags.end());
         frags.erase(f);
     }
@@ -280,6 +281,156 @@ TEST(translatorTest, IRPostOrdering)
     }
 }
 
+TEST(translatorTest, typeCheckerAnnotatesExpressions)
+{
+    std::string text = "class Main {\n"
+                       "  public static void main(String[] a) {\n"
+                       "   System.out.println(new A().g().f(true));\n"
+                       "  }\n"
+                       "}\n"
+                       "class A {\n"
+                       "  int n;\n"
+                       "  public A g() { return this; }\n"
+                       "  public int f(boolean b) {\n"
+                       "    n = 2 * n;\n"
+                       "    return n;\n"
+                       "  }\n"
+                       "}\n";
+    Parser parser("types", std::string_view(text));
+    auto   prog = parser.Program();
+    ASSERT_FALSE(parser.errors.has_errors());
+
+    helper::meta_data data(prog);
+    IR::TypeChecker   types(data, prog);
+
+    auto const& main = Grammar::get<AST::MainClassRule>(
+        Grammar::get<AST::ProgramRule>(prog).main);
+    auto const& call = Grammar::get<AST::methodCallExp>(
+        Grammar::get<AST::printStm>(main.body).exp);
+    EXPECT_EQ(types[Grammar::get<AST::printStm>(main.body).exp],
+              AST::TypeRef(AST::integerType{}));
+    EXPECT_EQ(types[call.object].name(), "A");
+    auto const& args = Grammar::get<AST::ExpListRule>(call.arguments);
+    EXPECT_EQ(types[args.exps[0]], AST::TypeRef(AST::booleanType{}));
+}
+
+TEST(translatorTest, typeCheckerIsTheSameOnAnyNumberOfThreads)
+{
+    TranslationUnit tu("../input/sample4.miniJava");
+    ASSERT_TRUE(tu.check());
+    helper::meta_data data(tu.syntax_tree);
+    IR::TypeChecker   serial(data, tu.syntax_tree, 1);
+    IR::TypeChecker   parallel(data, tu.syntax_tree, 4);
+
+    int typed = 0;
+    for (int id = 0;; id++) {
+        AST::TypeRef one, many;
+        try {
+            one = serial[id];
+        } catch (std::out_of_range const&) {
+            EXPECT_THROW(parallel[id], std::out_of_range);
+            break;
+        } catch (std::bad_optional_access const&) {
+            EXPECT_THROW(parallel[id], std::bad_optional_access);
+            continue;
+        }
+        EXPECT_EQ(one, parallel[id]);
+        typed++;
+    }
+    EXPECT_GT(typed, 0);
+}
+
+TEST(translatorTest, typeCheckerRejectsMismatches)
+{
+    std::string text = "class Main {\n"
+                       "  public static void main(String[] a) {\n"
+                       "    System.out.println(1 + true);\n"
+                       "  }\n"
+                       "}\n";
+    Parser parser("types", std::string_view(text));
+    auto   prog = parser.Program();
+
+    helper::meta_data data(prog);
+    EXPECT_THROW(IR::TypeChecker(data, prog), IR::TypeError);
+}
+
+TEST(translatorTest, typeCheckerWeighsWholeClassTypes)
+{
+    auto check = [](std::string const& call) {
+        std::string text = "class Main {\n"
+                           "  public static void main(String[] a) {\n"
+                           "    System.out.println(" +
+                           call +
+                           ");\n"
+                           "  }\n"
+                           "}\n"
+                           "class Pet {\n"
+                           "  public int id() { return 1; }\n"
+                           "}\n"
+                           "class Cat extends Pet { }\n"
+                           "class Car { }\n"
+                           "class Vet {\n"
+                           "  public int see(Pet p) {\n"
+                           "    return p.id();\n"
+                           "  }\n"
+                           "}\n";
+        Parser parser("whole", std::string_view(text));
+        auto   prog = parser.Program();
+        helper::meta_data data(prog);
+        IR::TypeChecker(data, prog);
+    };
+
+    EXPECT_NO_THROW(check("new Vet().see(new Pet())"));
+    EXPECT_NO_THROW(check("new Vet().see(new Cat())"));
+    EXPECT_THROW(check("new Vet().see(new Car())"), IR::TypeError);
+    EXPECT_THROW(check("new Vet().see()"), IR::ArityError);
+    EXPECT_THROW(check("new Vet().see(new Pet(), 1)"),
+                 IR::ArityError);
+}
+
+TEST(translatorTest, shardsMergeIntoTheSerialTree)
+{
+    std::string text = "class Main {\n"
+                       "  public static void main(String[] a) {\n"
+                       "    System.out.println(new ShardB().g());\n"
+                       "  }\n"
+                       "}\n"
+                       "class ShardA {\n"
+                       "  public int f(int x) {\n"
+                       "    if (x < 1) x = new ShardB().h();\n"
+                       "    else x = this.f(x - 1);\n"
+                       "    return x;\n"
+                       "  }\n"
+                       "}\n"
+                       "class ShardB extends ShardA {\n"
+                       "  public int g() { return this.f(2); }\n"
+                       "  public int h() { return 1; }\n"
+                       "}\n";
+    Parser parser("shards", std::string_view(text));
+    auto   prog = parser.Program();
+    ASSERT_FALSE(parser.errors.has_errors());
+
+    // The serial run goes first, so it interns the labels itself, as
+    // it would in a process of its own, and the shards only find them
+    IR::Tree     parallel, serial;
+    size_t const known = Symbol::count();
+    IR::translate(serial, prog, 1);
+    EXPECT_GT(Symbol::count(), known);
+    IR::translate(parallel, prog, 4);
+
+    std::vector<std::string> order;
+    for (auto const& mtd : parallel.methods)
+        order.push_back(mtd.first.str());
+    EXPECT_EQ(order, (std::vector<std::string>{
+                         "_ZShardA_f", "_ZShardB_g", "_ZShardB_h",
+                         "main"}));
+
+    std::stringstream one, many;
+    serial.dump(one);
+    parallel.dump(many);
+    EXPECT_EQ(one.str(), many.str());
+}
+
 int main(int argc, char** argv)
 {
     ::testing::InitGoogleTest(&argc, argv);